@@ -0,0 +1,91 @@
+/**
+ * This example reads the P1 meter once every 30 seconds and sleeps in between, for battery powered nodes
+ * The request (CTS) pin is only raised when a reading is due. Every reading is a valid telegram and
+ * the awake time, CPU time and estimated charge of the reading are printed
+ */
+
+#include "P1MeterParser.h"
+
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#elif defined(ESP32)
+#include <esp_sleep.h>
+#endif
+
+#define CTS_PIN 5
+#define P1_BAUD 115200 // DSMR 2.2 and 3.0 meters use 9600 baud
+#define P1_CONFIG SERIAL_8N1 // DSMR 2.2 and 3.0 meters use SERIAL_7E1
+
+#define READ_INTERVAL 30000 // Milliseconds between two readings
+#define READ_TIMEOUT 12000 // Milliseconds to wait for a valid telegram before giving up on a reading
+#define ACTIVE_CURRENT 20000 // Current of the board while awake in uA, measure your own board
+#define SLEEP_CURRENT 5000 // Current of the board while sleeping in uA
+
+// If using an ESP32 check which module you are using. The default pins of Serial1 and Serial2 might be in use by PSRAM or Flash
+#if defined(ESP32)
+#define ESP32_SERIAL1_TX 21
+#define ESP32_SERIAL1_RX 22
+#endif
+
+// Use Serial1 as the hardware serial for the P1 connection
+HardwareSerial *P1Serial = &Serial1;
+
+// Create a meter object. The CTS pin is needed to stop the meter from sending in between readings
+P1Meter meter(P1Serial, CTS_PIN);
+
+// Called by the meter when no reading is due. Sleeps at most the given time, any interrupt wakes the MCU up earlier
+void sleepMcu(uint32_t milliseconds) {
+  Serial.flush(); // Finish the logging before sleeping
+#if defined(__AVR__)
+  // Idle keeps the UART and millis running. Timer 0 wakes the MCU up every millisecond
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_mode();
+#elif defined(ESP32)
+  // Light sleep keeps the RAM, wake up by the timer or UART activity
+  esp_sleep_enable_timer_wakeup((uint64_t)milliseconds * 1000);
+  esp_sleep_enable_uart_wakeup(1);
+  esp_light_sleep_start();
+#else
+  delay(milliseconds > 10 ? 10 : milliseconds);
+#endif
+}
+
+void setup() {
+  // put your setup code here, to run once:
+  Serial.begin(115200); // Serial logging
+
+  // Start the P1 Serial
+#if defined(__avr__)
+  P1Serial->begin(P1_BAUD, P1_CONFIG);
+#elif defined(ESP8266)
+  P1Serial->begin(P1_BAUD, (SerialConfig)P1_CONFIG);
+#elif defined(ESP32)
+  P1Serial->begin(P1_BAUD, P1_CONFIG, ESP32_SERIAL1_RX, ESP32_SERIAL1_TX);
+#endif
+
+  meter.SetReadInterval(READ_INTERVAL, sleepMcu, READ_TIMEOUT);
+  meter.SetSupplyCurrent(ACTIVE_CURRENT, SLEEP_CURRENT);
+}
+
+void loop() {
+  // put your main code here, to run repeatedly:
+  meter.ReceiveTelegram(); // Sleeps until the next reading is due, then waits at most READ_TIMEOUT for a valid telegram
+  if (meter.DataReady) {
+    P1Data data = meter.ProcessTelegram();
+
+    Serial.print("Current consumption: ");
+    Serial.print(data.ActualDelivered);
+    Serial.println(" W");
+
+    P1ReadingStats stats = meter.GetReadingStats();
+    Serial.print("Awake: ");
+    Serial.print(stats.AwakeMillis);
+    Serial.print(" ms, CPU: ");
+    Serial.print(stats.CpuMicros);
+    Serial.print(" us, telegrams: ");
+    Serial.print(stats.Telegrams);
+    Serial.print(", charge: ");
+    Serial.print(stats.Charge);
+    Serial.println(" nAh");
+  }
+}
@@ -6,8 +6,8 @@
 #include "P1MeterParser.h"
 
 #define CTS_PIN 5
-#define P1_BAUD 115200
-#define P1_CONFIG SERIAL_8N1
+#define P1_BAUD 115200 // DSMR 2.2 and 3.0 meters use 9600 baud
+#define P1_CONFIG SERIAL_8N1 // DSMR 2.2 and 3.0 meters use SERIAL_7E1
 
 // If using an ESP32 check which module you are using. The default pins of Serial1 and Serial2 might be in use by PSRAM or Flash
 #if defined(ESP32)
@@ -27,11 +27,11 @@ void setup() {
 
   // Start the P1 Serial
 #if defined(__avr__)
-  P1Serial->begin(P1_BAUD, SERIAL_8N1);
+  P1Serial->begin(P1_BAUD, P1_CONFIG);
 #elif defined(ESP8266)
-  P1Serial->begin(P1_BAUD, (SerialConfig)SERIAL_8N1);
+  P1Serial->begin(P1_BAUD, (SerialConfig)P1_CONFIG);
 #elif defined(ESP32)
-  P1Serial->begin(P1_BAUD, SERIAL_8N1, ESP32_SERIAL1_RX, ESP32_SERIAL1_TX);
+  P1Serial->begin(P1_BAUD, P1_CONFIG, ESP32_SERIAL1_RX, ESP32_SERIAL1_TX);
 #endif
 }
 
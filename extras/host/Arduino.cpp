@@ -0,0 +1,14 @@
+/**
+ * @file Arduino.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Minimal Arduino API for building the library on a Linux host (tools, benchmarks and the gateway)
+ * @version 0.1
+ * @date 2022-03-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "Arduino.h"
+
+void (*ArduinoPinHook)(uint8_t pin, uint8_t function, uint8_t value) = NULL;
@@ -0,0 +1,105 @@
+/**
+ * @file Arduino.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Minimal Arduino API for building the library on a Linux host (tools, benchmarks and the gateway)
+ * @version 0.1
+ * @date 2022-03-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Only what the library uses is provided. Pin functions call an optional hook so tools can follow the CTS/request line
+ */
+
+#ifndef ARDUINO_HOST_H
+#define ARDUINO_HOST_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+typedef uint8_t byte;
+
+#define HIGH    0x1
+#define LOW     0x0
+#define INPUT   0x0
+#define OUTPUT  0x1
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+#define pgm_read_ptr(address) (*(void * const *)(address))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strncmp_P strncmp
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+class String : public std::string {
+public:
+    String() {}
+    String(const char *value) : std::string(value) {}
+    String(const std::string &value) : std::string(value) {}
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        size_t written = 0;
+        while (written < size && write(buffer[written])) written++;
+        return written;
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+class HardwareSerial : public Stream {
+};
+
+/**
+ * @brief Called on every pinMode and digitalWrite so a simulator can follow the request line. NULL by default
+ */
+extern void (*ArduinoPinHook)(uint8_t pin, uint8_t function, uint8_t value);
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+    if (ArduinoPinHook != NULL) ArduinoPinHook(pin, 0, mode);
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t value) {
+    if (ArduinoPinHook != NULL) ArduinoPinHook(pin, 1, value);
+}
+
+inline unsigned long micros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+
+inline unsigned long millis() {
+    return micros() / 1000;
+}
+
+inline void delay(unsigned long ms) {
+    struct timespec duration = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000L };
+    nanosleep(&duration, NULL);
+}
+
+inline void yield() {
+}
+
+#endif // ARDUINO_HOST_H
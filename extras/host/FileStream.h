@@ -0,0 +1,51 @@
+/**
+ * @file FileStream.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Stream on a stdio file for the host builds, the counterpart of a File on an SD card
+ * @version 0.1
+ * @date 2022-03-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef FILESTREAM_H
+#define FILESTREAM_H
+
+#include "Arduino.h"
+
+/**
+ * @brief Reads and writes a FILE through the Stream interface. The file is not closed by the stream
+ *
+ */
+class FileStream : public Stream {
+public:
+    FileStream(FILE *file) : file(file) {}
+
+    int available() override {
+        return peek() < 0 ? 0 : 1;
+    }
+
+    int read() override {
+        return fgetc(file);
+    }
+
+    int peek() override {
+        int value = fgetc(file);
+        if (value >= 0) ungetc(value, file);
+        return value;
+    }
+
+    size_t write(uint8_t value) override {
+        return fputc(value, file) == EOF ? 0 : 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override {
+        return fwrite(buffer, 1, size, file);
+    }
+
+private:
+    FILE *file;
+};
+
+#endif // FILESTREAM_H
@@ -0,0 +1,343 @@
+/**
+ * @file P1ColumnKernels.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Sums, minimum, maximum, register deltas and histograms over the column arrays of @see P1ColumnBatch
+ * @version 0.1
+ * @date 2022-06-04
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The vector loops handle 8 rows at a time, one byte of the Valid bitmap, from the first row that starts a byte. The rows
+ * before and after are handled by the plain loops, which are also the fallback without AVX2 or NEON
+ */
+
+#include <algorithm>
+
+#include "P1ColumnKernels.h"
+#include "P1Register.h"
+
+#if !defined(P1_COLUMN_SCALAR) && defined(__AVX2__)
+#define P1_COLUMN_AVX2
+#include <immintrin.h>
+#elif !defined(P1_COLUMN_SCALAR) && defined(__ARM_NEON) && defined(__aarch64__)
+#define P1_COLUMN_NEON
+#include <arm_neon.h>
+#endif
+
+#define HISTOGRAM_COPIES    4 // Rows in a row of the same bin are counted in different copies, so the increments don't wait on each other
+#define HISTOGRAM_MAX_BINS  256 // Larger histograms are counted in place
+
+/***************** Helper functions *****************/
+
+static inline bool rowValid(const uint8_t *valid, size_t row) {
+    return valid == NULL || (valid[row / 8] >> (row % 8) & 1);
+}
+
+static inline uint8_t validByte(const uint8_t *valid, size_t row) {
+    return valid != NULL ? valid[row / 8] : 0xFF;
+}
+
+static inline void aggregateRow(P1ColumnStats &stats, uint32_t value) {
+    stats.Sum += value;
+    if (value < stats.Min) stats.Min = value;
+    if (value > stats.Max) stats.Max = value;
+    stats.Count++;
+}
+
+/**
+ * @brief The increase of a register since the previous row, 0 when either row is not valid. @see P1RegisterDelta
+ *
+ */
+static inline uint32_t rowDelta(const uint32_t *values, const uint8_t *valid, size_t row) {
+    if (row == 0 || !rowValid(valid, row) || !rowValid(valid, row - 1)) return 0;
+    return P1RegisterDelta(values[row], values[row - 1]);
+}
+
+static inline uint16_t histogramBin(uint32_t value, uint32_t low, uint32_t width, uint16_t binCount) {
+    uint32_t bin = value > low ? (value - low) / width : 0;
+    return bin < binCount ? bin : binCount - 1;
+}
+
+/**
+ * @brief Finds the first row at or after timestamp, starting at row. The timestamps must be ascending
+ *
+ */
+static size_t rowAt(const uint32_t *timestamps, size_t row, size_t rows, uint64_t timestamp) {
+    if (timestamp > 0xFFFFFFFFULL) return rows;
+    return std::lower_bound(timestamps + row, timestamps + rows, (uint32_t)timestamp) - timestamps;
+}
+
+#if defined(P1_COLUMN_AVX2)
+/**
+ * @brief Expands a byte of a Valid bitmap to a lane mask, all ones for the rows set
+ *
+ */
+static inline __m256i laneMask(uint8_t bits) {
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), lanes), lanes);
+}
+
+static inline uint64_t sum64(__m256i sum) {
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    return _mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1);
+}
+
+static inline __m256i widenAdd(__m256i sum, __m256i values) {
+    sum = _mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(values)));
+    return _mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(values, 1)));
+}
+#elif defined(P1_COLUMN_NEON)
+static inline uint32x4_t laneMask(uint8_t bits, uint8_t shift) {
+    static const uint32_t lanes[4] = { 1, 2, 4, 8 };
+    return vtstq_u32(vdupq_n_u32(bits >> shift), vld1q_u32(lanes));
+}
+#endif
+
+/***************** Kernels *****************/
+
+/**
+ * @brief Gets the instruction set the kernels were built for
+ *
+ * @return const char* "avx2", "neon" or "scalar"
+ */
+const char *P1ColumnKernelName() {
+#if defined(P1_COLUMN_AVX2)
+    return "avx2";
+#elif defined(P1_COLUMN_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+/**
+ * @brief Adds an aggregate to another, e.g. of the batches parsed by different threads
+ *
+ */
+void P1ColumnMerge(P1ColumnStats &into, const P1ColumnStats &from) {
+    into.Sum += from.Sum;
+    if (from.Min < into.Min) into.Min = from.Min;
+    if (from.Max > into.Max) into.Max = from.Max;
+    into.Count += from.Count;
+}
+
+/**
+ * @brief Gets the sum, minimum and maximum of a column
+ *
+ * @param values The column, e.g. Columns[Column_ActualDelivered]
+ * @param valid The Valid bitmap of the column, NULL to count all rows
+ * @param begin The first row
+ * @param end The row after the last one
+ */
+P1ColumnStats P1ColumnAggregate(const uint32_t *values, const uint8_t *valid, size_t begin, size_t end) {
+    P1ColumnStats stats;
+    size_t row = begin;
+    for (; row < end && row % 8 != 0; row++) {
+        if (rowValid(valid, row)) aggregateRow(stats, values[row]);
+    }
+
+#if defined(P1_COLUMN_AVX2)
+    __m256i sum = _mm256_setzero_si256(), minimum = _mm256_set1_epi32(-1), maximum = _mm256_setzero_si256();
+    for (; row + 8 <= end; row += 8) {
+        uint8_t bits = validByte(valid, row);
+        if (bits == 0) continue;
+        __m256i mask = laneMask(bits), value = _mm256_loadu_si256((const __m256i *)(values + row));
+        __m256i kept = _mm256_and_si256(value, mask);
+        sum = widenAdd(sum, kept);
+        maximum = _mm256_max_epu32(maximum, kept);
+        minimum = _mm256_min_epu32(minimum, _mm256_or_si256(value, _mm256_xor_si256(mask, _mm256_set1_epi32(-1))));
+        stats.Count += __builtin_popcount(bits);
+    }
+
+    uint32_t lanes[8];
+    stats.Sum += sum64(sum);
+    _mm256_storeu_si256((__m256i *)lanes, minimum);
+    for (uint8_t i = 0; i < 8; i++) stats.Min = lanes[i] < stats.Min ? lanes[i] : stats.Min;
+    _mm256_storeu_si256((__m256i *)lanes, maximum);
+    for (uint8_t i = 0; i < 8; i++) stats.Max = lanes[i] > stats.Max ? lanes[i] : stats.Max;
+#elif defined(P1_COLUMN_NEON)
+    uint64x2_t sum = vdupq_n_u64(0);
+    uint32x4_t minimum = vdupq_n_u32(0xFFFFFFFF), maximum = vdupq_n_u32(0);
+    for (; row + 8 <= end; row += 8) {
+        uint8_t bits = validByte(valid, row);
+        if (bits == 0) continue;
+        for (uint8_t half = 0; half < 2; half++) {
+            uint32x4_t mask = laneMask(bits, 4 * half), value = vld1q_u32(values + row + 4 * half);
+            uint32x4_t kept = vandq_u32(value, mask);
+            sum = vpadalq_u32(sum, kept);
+            maximum = vmaxq_u32(maximum, kept);
+            minimum = vminq_u32(minimum, vornq_u32(value, mask));
+        }
+        stats.Count += __builtin_popcount(bits);
+    }
+
+    stats.Sum += vaddvq_u64(sum);
+    if (vminvq_u32(minimum) < stats.Min) stats.Min = vminvq_u32(minimum);
+    if (vmaxvq_u32(maximum) > stats.Max) stats.Max = vmaxvq_u32(maximum);
+#endif
+
+    for (; row < end; row++) {
+        if (rowValid(valid, row)) aggregateRow(stats, values[row]);
+    }
+    return stats;
+}
+
+/**
+ * @brief Gets the increases of a register column, e.g. the energy delivered in every interval from Columns[Column_DeliveredTariff1]
+ *
+ * @param begin The first row, its increase is from the row before it
+ * @param deltas Receives the increase of every row at the same index, 0 when it or the row before is not valid. When the register
+ * went back the value itself is taken as the increase, @see P1RegisterDelta. May be NULL
+ * @return uint64_t The sum of the increases
+ */
+uint64_t P1ColumnDeltas(const uint32_t *values, const uint8_t *valid, size_t begin, size_t end, uint32_t *deltas) {
+    uint64_t total = 0;
+    size_t row = begin;
+    for (; row < end && (row % 8 != 0 || row == 0); row++) { // The vector loop needs the row before
+        uint32_t delta = rowDelta(values, valid, row);
+        if (deltas != NULL) deltas[row] = delta;
+        total += delta;
+    }
+
+#if defined(P1_COLUMN_AVX2)
+    __m256i sum = _mm256_setzero_si256();
+    for (; row + 8 <= end; row += 8) {
+        uint8_t bits = validByte(valid, row);
+        bits &= bits << 1 | validByte(valid, row - 1) >> 7; // The row before is valid as well
+        __m256i value = _mm256_loadu_si256((const __m256i *)(values + row));
+        __m256i previous = _mm256_loadu_si256((const __m256i *)(values + row - 1));
+        __m256i increased = _mm256_cmpeq_epi32(_mm256_max_epu32(value, previous), value);
+        __m256i delta = _mm256_and_si256(_mm256_blendv_epi8(value, _mm256_sub_epi32(value, previous), increased), laneMask(bits));
+        if (deltas != NULL) _mm256_storeu_si256((__m256i *)(deltas + row), delta);
+        sum = widenAdd(sum, delta);
+    }
+    total += sum64(sum);
+#elif defined(P1_COLUMN_NEON)
+    uint64x2_t sum = vdupq_n_u64(0);
+    for (; row + 8 <= end; row += 8) {
+        uint8_t bits = validByte(valid, row);
+        bits &= bits << 1 | validByte(valid, row - 1) >> 7; // The row before is valid as well
+        for (uint8_t half = 0; half < 2; half++) {
+            uint32x4_t value = vld1q_u32(values + row + 4 * half), previous = vld1q_u32(values + row + 4 * half - 1);
+            uint32x4_t delta = vandq_u32(vbslq_u32(vcgeq_u32(value, previous), vsubq_u32(value, previous), value), laneMask(bits, 4 * half));
+            if (deltas != NULL) vst1q_u32(deltas + row + 4 * half, delta);
+            sum = vpadalq_u32(sum, delta);
+        }
+    }
+    total += vaddvq_u64(sum);
+#endif
+
+    for (; row < end; row++) {
+        uint32_t delta = rowDelta(values, valid, row);
+        if (deltas != NULL) deltas[row] = delta;
+        total += delta;
+    }
+    return total;
+}
+
+/**
+ * @brief Counts the rows of a column in bins of equal width, e.g. Columns[Column_VoltageL1] in bins of 1 V
+ *
+ * @param low The lowest value of the first bin, lower values are counted in the first bin
+ * @param width The width of a bin, values beyond the last bin are counted in the last bin
+ * @param bins The counts, the rows are added to them
+ * @param binCount The number of bins
+ * @return bool False when width or binCount is 0
+ */
+bool P1ColumnHistogram(const uint32_t *values, const uint8_t *valid, size_t begin, size_t end, uint32_t low, uint32_t width, uint32_t *bins,
+                       uint16_t binCount) {
+    if (width == 0 || binCount == 0) return false;
+    size_t row = begin;
+
+#if defined(P1_COLUMN_AVX2)
+    // The bin is the offset multiplied by the rounded up reciprocal of the width, which is exact while the offset times the width
+    // stays below 2^32. The offsets are limited to the last bin first, so that holds when the range of the bins times the width does
+    uint64_t range = (uint64_t)binCount * width;
+    if (width >= 2 && binCount <= HISTOGRAM_MAX_BINS && range * width <= 0x100000000ULL && end - begin >= 64) {
+        uint32_t copies[HISTOGRAM_COPIES][HISTOGRAM_MAX_BINS] = {};
+        for (; row < end && row % 8 != 0; row++) {
+            if (rowValid(valid, row)) copies[0][histogramBin(values[row], low, width, binCount)]++;
+        }
+
+        const __m256i lowest = _mm256_set1_epi32(low), highest = _mm256_set1_epi32(range - 1);
+        const __m256i reciprocal = _mm256_set1_epi64x((0x100000000ULL + width - 1) / width);
+        uint32_t offsets[8];
+        for (; row + 8 <= end; row += 8) {
+            uint8_t bits = validByte(valid, row);
+            if (bits == 0) continue;
+            __m256i value = _mm256_loadu_si256((const __m256i *)(values + row));
+            __m256i offset = _mm256_min_epu32(_mm256_sub_epi32(_mm256_max_epu32(value, lowest), lowest), highest);
+            __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(offset, reciprocal), 32);
+            __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(offset, 32), reciprocal);
+            _mm256_storeu_si256((__m256i *)offsets, _mm256_blend_epi32(even, odd, 0xAA));
+            for (uint8_t lane = 0; lane < 8; lane++) {
+                if (bits >> lane & 1) copies[lane % HISTOGRAM_COPIES][offsets[lane]]++;
+            }
+        }
+
+        for (; row < end; row++) {
+            if (rowValid(valid, row)) copies[0][histogramBin(values[row], low, width, binCount)]++;
+        }
+        for (uint16_t bin = 0; bin < binCount; bin++) {
+            for (uint8_t copy = 0; copy < HISTOGRAM_COPIES; copy++) bins[bin] += copies[copy][bin];
+        }
+        return true;
+    }
+#endif
+
+    for (; row < end; row++) {
+        if (rowValid(valid, row)) bins[histogramBin(values[row], low, width, binCount)]++;
+    }
+    return true;
+}
+
+/**
+ * @brief Aggregates a column per time bucket, e.g. the power per 15 minutes. Every bucket is a run of rows aggregated by
+ * @see P1ColumnAggregate, so the rows must be in time order, as parsed from the archive of one meter
+ *
+ * @param timestamps Columns[Column_DateTime] in ascending order
+ * @param rows The number of rows
+ * @param start The start of the first bucket, rows before it are skipped
+ * @param bucketSeconds The length of a bucket
+ * @param buckets The aggregates, the rows are merged into them
+ * @param bucketCount The number of buckets, rows after the last one are skipped
+ * @return size_t The number of rows in the buckets, valid or not
+ */
+size_t P1ColumnAggregateBuckets(const uint32_t *timestamps, const uint32_t *values, const uint8_t *valid, size_t rows, uint32_t start,
+                                uint32_t bucketSeconds, P1ColumnStats *buckets, size_t bucketCount) {
+    if (bucketSeconds == 0) return 0;
+    size_t counted = 0;
+    for (size_t row = rowAt(timestamps, 0, rows, start); row < rows;) {
+        size_t bucket = (timestamps[row] - start) / bucketSeconds;
+        if (bucket >= bucketCount) break;
+
+        size_t next = rowAt(timestamps, row, rows, (uint64_t)start + (uint64_t)(bucket + 1) * bucketSeconds);
+        P1ColumnMerge(buckets[bucket], P1ColumnAggregate(values, valid, row, next));
+        counted += next - row;
+        row = next;
+    }
+    return counted;
+}
+
+/**
+ * @brief Sums the increases of a register column per time bucket, e.g. the energy delivered per hour. The increase since the row
+ * before is counted in the bucket of the row. The rows must be in time order, see @see P1ColumnAggregateBuckets
+ *
+ * @param buckets The sums, the increases are added to them
+ * @return size_t The number of rows in the buckets, valid or not
+ */
+size_t P1ColumnDeltaBuckets(const uint32_t *timestamps, const uint32_t *values, const uint8_t *valid, size_t rows, uint32_t start,
+                            uint32_t bucketSeconds, uint64_t *buckets, size_t bucketCount) {
+    if (bucketSeconds == 0) return 0;
+    size_t counted = 0;
+    for (size_t row = rowAt(timestamps, 0, rows, start); row < rows;) {
+        size_t bucket = (timestamps[row] - start) / bucketSeconds;
+        if (bucket >= bucketCount) break;
+
+        size_t next = rowAt(timestamps, row, rows, (uint64_t)start + (uint64_t)(bucket + 1) * bucketSeconds);
+        buckets[bucket] += P1ColumnDeltas(values, valid, row, next, NULL);
+        counted += next - row;
+        row = next;
+    }
+    return counted;
+}
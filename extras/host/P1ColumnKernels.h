@@ -0,0 +1,44 @@
+/**
+ * @file P1ColumnKernels.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Sums, minimum, maximum, register deltas and histograms over the column arrays of @see P1ColumnBatch
+ * @version 0.1
+ * @date 2022-06-04
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The kernels use AVX2 or NEON (aarch64) when the compiler targets it, e.g. with -march=native, and plain loops otherwise.
+ * Define P1_COLUMN_SCALAR to always use the plain loops. They work on the rows begin up to end of a column, counting only the rows
+ * set in its Valid bitmap (all rows when the bitmap is NULL)
+ */
+
+#ifndef P1COLUMNKERNELS_H
+#define P1COLUMNKERNELS_H
+
+#include "P1MeterParser.h"
+
+/**
+ * @brief Aggregate of a column, merged with @see P1ColumnMerge. Value initialize it, e.g. new P1ColumnStats[n](), to start empty
+ *
+ */
+struct P1ColumnStats {
+    uint64_t Sum = 0;
+    uint32_t Min = 0xFFFFFFFF; // 0xFFFFFFFF and Max 0 when no row was counted
+    uint32_t Max = 0;
+    uint32_t Count = 0; // The rows counted
+};
+
+const char *P1ColumnKernelName();
+void P1ColumnMerge(P1ColumnStats &into, const P1ColumnStats &from);
+
+P1ColumnStats P1ColumnAggregate(const uint32_t *values, const uint8_t *valid, size_t begin, size_t end);
+uint64_t P1ColumnDeltas(const uint32_t *values, const uint8_t *valid, size_t begin, size_t end, uint32_t *deltas);
+bool P1ColumnHistogram(const uint32_t *values, const uint8_t *valid, size_t begin, size_t end, uint32_t low, uint32_t width, uint32_t *bins,
+                       uint16_t binCount);
+
+size_t P1ColumnAggregateBuckets(const uint32_t *timestamps, const uint32_t *values, const uint8_t *valid, size_t rows, uint32_t start,
+                                uint32_t bucketSeconds, P1ColumnStats *buckets, size_t bucketCount);
+size_t P1ColumnDeltaBuckets(const uint32_t *timestamps, const uint32_t *values, const uint8_t *valid, size_t rows, uint32_t start,
+                            uint32_t bucketSeconds, uint64_t *buckets, size_t bucketCount);
+
+#endif // P1COLUMNKERNELS_H
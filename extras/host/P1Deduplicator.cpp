@@ -0,0 +1,177 @@
+/**
+ * @file P1Deduplicator.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Detects telegrams received twice, e.g. retransmitted by a gateway after a reconnect, before they are parsed
+ * @version 0.1
+ * @date 2022-05-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1Deduplicator.h"
+#include "CRC16.h"
+#include "P1DateTime.h"
+#include "P1Hex.h"
+
+/***************** Helper functions *****************/
+
+/**
+ * @brief Finds a line starting with the OBIS code
+ *
+ * @return const char* The first character after the code or NULL
+ */
+static const char *findLine(const char *telegram, const char *end, const char *obis) {
+    uint8_t length = strlen(obis);
+    for (const char *line = telegram; line != NULL && line + length < end;) {
+        if (memcmp(line, obis, length) == 0) return line + length;
+        line = (const char *)memchr(line, '\n', end - line);
+        if (line != NULL) line++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Construct a new deduplicator
+ *
+ * @param windowSeconds The time window of a table, longer than the delay of a retransmission
+ * @param capacity The number of telegrams per window. Telegrams beyond this are passed on unchecked
+ */
+P1Deduplicator::P1Deduplicator(uint32_t windowSeconds, uint32_t capacity) {
+    this->windowSeconds = windowSeconds > 0 ? windowSeconds : 1;
+    this->capacity = capacity;
+
+    uint32_t slotCount = 2;
+    while (slotCount < 2 * capacity) slotCount *= 2;
+    slotMask = slotCount - 1;
+
+    for (uint8_t i = 0; i < 2; i++) {
+        windows[i].slots = new key[slotCount]();
+        windows[i].number = 0;
+        windows[i].count = 0;
+        windows[i].used = false;
+    }
+}
+
+P1Deduplicator::~P1Deduplicator() {
+    delete[] windows[0].slots;
+    delete[] windows[1].slots;
+}
+
+/**
+ * @brief Checks a framed telegram, from '/' up to and including the newline after the CRC
+ *
+ * @return bool True when the telegram was seen before. Telegrams with an invalid CRC or without timestamp or equipment identifier
+ * are never duplicates and are not remembered, so a valid retransmission of a corrupted telegram still gets through
+ */
+bool P1Deduplicator::Duplicate(const char *telegram, uint16_t length) {
+    char equipmentID[P1_EQUIPMENT_ID_SIZE];
+    uint32_t timestamp;
+    uint16_t crc;
+    if (!Peek(telegram, length, equipmentID, timestamp, crc)) return false;
+
+    return Seen(MeterHash(equipmentID), timestamp, crc);
+}
+
+/**
+ * @brief Checks whether a telegram was seen before and remembers it when not
+ *
+ * @param meter The meter, see @see MeterHash. Two meters with the same hash only collide on a telegram with the same timestamp and CRC
+ * @param timestamp The time of the telegram, see P1DateTimeToSeconds
+ * @param crc The CRC of the telegram, 0 for DSMR 2.2 and 3.0
+ * @return bool True when the telegram was seen before
+ */
+bool P1Deduplicator::Seen(uint32_t meter, uint32_t timestamp, uint16_t crc) {
+    uint32_t number = timestamp / windowSeconds;
+    window &table = windows[number & 1];
+
+    if (!table.used || number > table.number) { // Next window, forget the one before the previous
+        memset(table.slots, 0, (slotMask + 1) * sizeof(key));
+        table.number = number;
+        table.count = 0;
+        table.used = true;
+    } else if (number < table.number) { // Older than the windows kept
+        return false;
+    }
+
+    uint32_t hash = (meter * 0x9E3779B1UL) ^ (timestamp * 0x85EBCA77UL) ^ (crc * 0xC2B2AE3DUL);
+    hash ^= hash >> 15;
+    for (uint32_t slot = hash & slotMask;; slot = (slot + 1) & slotMask) {
+        key &entry = table.slots[slot];
+        if (!entry.used) {
+            if (table.count >= capacity) return false;
+            entry.used = true;
+            entry.meter = meter;
+            entry.timestamp = timestamp;
+            entry.crc = crc;
+            table.count++;
+            return false;
+        }
+        if (entry.meter == meter && entry.timestamp == timestamp && entry.crc == crc) {
+            duplicates++;
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief Gets the number of duplicates detected
+ *
+ */
+uint32_t P1Deduplicator::Duplicates() {
+    return duplicates;
+}
+
+/**
+ * @brief Hashes an equipment identifier into the meter key of @see Seen
+ *
+ * @param equipmentID The decoded equipment identifier
+ * @return uint32_t FNV-1a hash of the identifier
+ */
+uint32_t P1Deduplicator::MeterHash(const char *equipmentID) {
+    uint32_t result = 2166136261UL;
+    for (; *equipmentID != 0; equipmentID++) {
+        result = (result ^ (uint8_t)*equipmentID) * 16777619UL;
+    }
+    return result;
+}
+
+/**
+ * @brief Checks the CRC of a raw telegram and picks the fields identifying it without parsing the rest
+ *
+ * @param equipmentID Receives the decoded equipment identifier, at least P1_EQUIPMENT_ID_SIZE characters
+ * @param timestamp Receives the time of the telegram, see P1DateTimeToSeconds
+ * @param crc Receives the CRC sent by the meter, 0 for DSMR 2.2 and 3.0
+ * @return bool False when the CRC is not valid or the timestamp or equipment identifier is missing
+ */
+bool P1Deduplicator::Peek(const char *telegram, uint16_t length, char *equipmentID, uint32_t &timestamp, uint16_t &crc) {
+    const char *end = telegram + length;
+
+    // The CRC follows the '!' at the start of the last line
+    const char *last = end - 1;
+    while (last > telegram && *last != '!') last--;
+    if (*last != '!' || last == telegram || last[-1] != '\n') return false;
+    if (last + 1 < end && last[1] == '\r') { // DSMR 2.2 and 3.0 have no CRC
+        crc = 0;
+    } else {
+        if (last + 5 > end) return false;
+        crc = 0;
+        for (uint8_t i = 1; i <= 4; i++) {
+            uint8_t nibble = pgm_read_byte(&HEX_VALUES[(uint8_t)last[i]]);
+            if (nibble == HEX_INVALID) return false;
+            crc = (crc << 4) | nibble;
+        }
+        if (CRC16_IBM_REVERSED(telegram, last + 1 - telegram) != crc) return false;
+    }
+
+    const char *value = findLine(telegram, last, "0-0:1.0.0(");
+    if (value == NULL || value + 13 > last) return false;
+    timestamp = P1DateTimeToSeconds(value);
+
+    value = findLine(telegram, last, "0-0:96.1.1(");
+    if (value == NULL) return false;
+    const char *close = (const char *)memchr(value, ')', last - value);
+    if (close == NULL || close == value) return false;
+    P1DecodeHex(value, close - value, equipmentID, P1_EQUIPMENT_ID_SIZE);
+    return true;
+}
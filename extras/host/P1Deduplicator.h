@@ -0,0 +1,59 @@
+/**
+ * @file P1Deduplicator.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Detects telegrams received twice, e.g. retransmitted by a gateway after a reconnect, before they are parsed
+ * @version 0.1
+ * @date 2022-05-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note A telegram is identified by its meter, timestamp and CRC, the meter by a 32 bit hash of its equipment identifier so there
+ * is no limit on the number of meters. These are picked from the raw telegram after checking the CRC, so duplicates are dropped
+ * without decoding the rest. The keys are kept in two hash tables of one time window each: the table of the oldest window is
+ * cleared when a telegram of a new window arrives. Duplicates arriving more than a window late are not detected
+ */
+
+#ifndef P1DEDUPLICATOR_H
+#define P1DEDUPLICATOR_H
+
+#include "P1MeterParser.h"
+
+/**
+ * @brief Time windowed set of the telegrams seen
+ *
+ */
+class P1Deduplicator {
+public:
+    P1Deduplicator(uint32_t windowSeconds, uint32_t capacity);
+    ~P1Deduplicator();
+
+    bool Duplicate(const char *telegram, uint16_t length);
+    bool Seen(uint32_t meter, uint32_t timestamp, uint16_t crc);
+    uint32_t Duplicates();
+
+    static bool Peek(const char *telegram, uint16_t length, char *equipmentID, uint32_t &timestamp, uint16_t &crc);
+    static uint32_t MeterHash(const char *equipmentID);
+
+private:
+    struct key {
+        uint32_t meter; // Hash of the equipment identifier
+        uint32_t timestamp;
+        uint16_t crc;
+        bool used;
+    };
+
+    struct window {
+        key *slots;
+        uint32_t number; // Timestamp / windowSeconds
+        uint32_t count;
+        bool used;
+    };
+
+    uint32_t windowSeconds;
+    uint32_t capacity; // Per window
+    uint32_t slotMask;
+    window windows[2];
+    uint32_t duplicates = 0;
+};
+
+#endif // P1DEDUPLICATOR_H
@@ -0,0 +1,39 @@
+/**
+ * @file P1Framing.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Finds the end of a telegram in a buffer of concatenated telegrams, e.g. an archive or a chunk of a stream
+ * @version 0.1
+ * @date 2022-06-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef P1FRAMING_H
+#define P1FRAMING_H
+
+#include <Arduino.h>
+#include "P1MeterParser.h"
+
+/**
+ * @brief Finds the end of the telegram starting at start: the newline of the line starting with '!'
+ * @note Telegrams fit in the buffer of the parser, so the end is searched no further than BUFFER_SIZE - 1 bytes. When end is
+ * further away than that, NULL means the telegram is too long instead of not complete
+ *
+ * @param start The '/' starting the telegram
+ * @param end The end of the bytes received
+ * @return const char* The newline or NULL when the telegram is not complete
+ */
+inline const char *P1TelegramEnd(const char *start, const char *end) {
+    if (end - start > BUFFER_SIZE - 1) end = start + BUFFER_SIZE - 1;
+    const char *line = start;
+    while (line < end) {
+        const char *newline = (const char *)memchr(line, '\n', end - line);
+        if (newline == NULL) return NULL;
+        if (*line == '!') return newline;
+        line = newline + 1;
+    }
+    return NULL;
+}
+
+#endif // P1FRAMING_H
@@ -0,0 +1,198 @@
+/**
+ * @file P1StateStore.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Latest state of many meters, updated by ingest threads and read concurrently by others
+ * @version 0.1
+ * @date 2022-04-30
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1StateStore.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+static_assert(sizeof(P1MeterSnapshot) % sizeof(uint32_t) == 0, "P1MeterSnapshot is copied in words");
+static_assert(sizeof(P1MeterSnapshot) <= 60, "P1MeterSnapshot and its sequence must fit in a cache line");
+
+// Lets the other hardware thread of the core run while spinning on a slot
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Timestamp on a scale that keeps increasing when summer time ends, so the repeated hour isn't taken for older telegrams
+static inline uint32_t winterTime(const P1MeterSnapshot &snapshot) {
+    return snapshot.Flags & P1_RECORD_SUMMER_TIME ? snapshot.Timestamp - 3600 : snapshot.Timestamp;
+}
+
+/**
+ * @brief Construct a new store
+ *
+ * @param capacity The number of meters. Handles run from 0 up to capacity - 1
+ * @param shardBits The number of shards as a power of two
+ */
+P1StateStore::P1StateStore(uint32_t capacity, uint8_t shardBits) {
+    if (shardBits > 16) shardBits = 16;
+    this->capacity = capacity;
+    this->shardBits = shardBits;
+
+    uint32_t shardCount = 1UL << shardBits;
+    uint32_t slotsPerShard = (capacity + shardCount - 1) >> shardBits;
+    if (slotsPerShard == 0) slotsPerShard = 1;
+
+    void *memory = NULL;
+    if (posix_memalign(&memory, alignof(shard), shardCount * sizeof(shard)) != 0) abort();
+    shards = (shard *)memory;
+    for (uint32_t i = 0; i < shardCount; i++) {
+        if (posix_memalign(&memory, alignof(slot), slotsPerShard * sizeof(slot)) != 0) abort();
+        memset(memory, 0, slotsPerShard * sizeof(slot)); // All sequences 0, never written
+        shards[i].slots = (slot *)memory;
+        shards[i].updates.store(0, std::memory_order_relaxed);
+    }
+}
+
+P1StateStore::~P1StateStore() {
+    for (uint32_t i = 0; i < (1UL << shardBits); i++) {
+        free(shards[i].slots);
+    }
+    free(shards);
+}
+
+/**
+ * @brief Stores the hot fields of a parsed telegram as the latest state of a meter
+ *
+ * @param handle The meter
+ * @param data The result of P1Meter::ProcessTelegram
+ * @return bool False when the handle is out of range or the telegram is older than the stored one
+ */
+bool P1StateStore::Update(uint32_t handle, const P1Data &data) {
+    P1MeterSnapshot snapshot;
+    MakeSnapshot(data, snapshot);
+    return Update(handle, snapshot);
+}
+
+/**
+ * @brief Stores the latest state of a meter. Safe to call from several threads, also for the same meter
+ *
+ * @return bool False when the handle is out of range or the snapshot is older than the stored one
+ */
+bool P1StateStore::Update(uint32_t handle, const P1MeterSnapshot &snapshot) {
+    slot *target = find(handle);
+    if (target == NULL) return false;
+
+    uint32_t words[STATE_SNAPSHOT_WORDS];
+    memcpy(words, &snapshot, sizeof(words));
+
+    // An odd sequence also locks the slot against other writers
+    uint32_t sequence = target->sequence.load(std::memory_order_relaxed);
+    while ((sequence & 1) || !target->sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        cpuRelax();
+        sequence = target->sequence.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Telegrams arriving late through another gateway connection do not replace newer ones
+    if (sequence != 0) {
+        const uint8_t timestampWord = offsetof(P1MeterSnapshot, Timestamp) / sizeof(uint32_t);
+        const uint8_t flagsWord = offsetof(P1MeterSnapshot, Flags) / sizeof(uint32_t);
+        uint32_t storedWords[STATE_SNAPSHOT_WORDS] = {};
+        storedWords[timestampWord] = target->words[timestampWord].load(std::memory_order_relaxed);
+        storedWords[flagsWord] = target->words[flagsWord].load(std::memory_order_relaxed);
+        P1MeterSnapshot stored;
+        memcpy(&stored, storedWords, sizeof(storedWords));
+
+        if (winterTime(stored) > winterTime(snapshot)) {
+            target->sequence.store(sequence, std::memory_order_release);
+            return false;
+        }
+    }
+
+    for (uint8_t i = 0; i < STATE_SNAPSHOT_WORDS; i++) {
+        target->words[i].store(words[i], std::memory_order_relaxed);
+    }
+    target->sequence.store(sequence + 2, std::memory_order_release);
+
+    shards[handle & ((1UL << shardBits) - 1)].updates.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Gets the latest state of a meter without taking a lock
+ *
+ * @return bool False when the handle is out of range or the meter was never updated
+ */
+bool P1StateStore::Read(uint32_t handle, P1MeterSnapshot &snapshot) const {
+    const slot *source = find(handle);
+    if (source == NULL) return false;
+
+    uint32_t words[STATE_SNAPSHOT_WORDS];
+    uint32_t before, after;
+    do {
+        before = source->sequence.load(std::memory_order_acquire);
+        if (before == 0) return false;
+        if (before & 1) { // Being written
+            cpuRelax();
+            continue;
+        }
+
+        for (uint8_t i = 0; i < STATE_SNAPSHOT_WORDS; i++) {
+            words[i] = source->words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = source->sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    memcpy(&snapshot, words, sizeof(words));
+    return true;
+}
+
+uint32_t P1StateStore::Capacity() const {
+    return capacity;
+}
+
+/**
+ * @brief Gets the number of accepted updates of all shards
+ *
+ */
+uint64_t P1StateStore::Updates() const {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < (1UL << shardBits); i++) {
+        total += shards[i].updates.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Copies the hot fields of a parsed telegram
+ *
+ */
+void P1StateStore::MakeSnapshot(const P1Data &data, P1MeterSnapshot &snapshot) {
+    snapshot.Timestamp = P1DateTimeToSeconds(data.DateTime);
+    snapshot.Delivered[0] = data.DeliveredTariff1;
+    snapshot.Delivered[1] = data.DeliveredTariff2;
+    snapshot.Produced[0] = data.ProducedTariff1;
+    snapshot.Produced[1] = data.ProducedTariff2;
+    snapshot.ActualDelivered = data.ActualDelivered;
+    snapshot.ActualProduced = data.ActualProduced;
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        snapshot.Voltage[phase] = data.Voltage[phase] > 0xFFFF ? 0xFFFF : data.Voltage[phase];
+        snapshot.Current[phase] = data.Current[phase] > 0xFFFF ? 0xFFFF : data.Current[phase];
+    }
+    snapshot.MBusValue = data.MBusDevices[0].Reading.Value;
+    snapshot.CRC = data.CRC;
+    snapshot.Tariff = data.CurrentTariff;
+    snapshot.Flags = (data.ValidCRC ? P1_RECORD_VALID_CRC : 0) | (data.DateTime[12] == 'S' ? P1_RECORD_SUMMER_TIME : 0);
+}
+
+/***************** Helper functions *****************/
+
+P1StateStore::slot *P1StateStore::find(uint32_t handle) const {
+    if (handle >= capacity) return NULL;
+    return &shards[handle & ((1UL << shardBits) - 1)].slots[handle >> shardBits];
+}
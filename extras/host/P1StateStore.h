@@ -0,0 +1,80 @@
+/**
+ * @file P1StateStore.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Latest state of many meters, updated by ingest threads and read concurrently by others
+ * @version 0.1
+ * @date 2022-04-30
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Meters are addressed by a dense handle, e.g. from P1EquipmentRegistry. Every meter has a 64 byte slot with a compact
+ * snapshot guarded by a sequence lock: writers never wait for readers and readers take no lock, they only copy the slot again
+ * when a write to the same meter overlapped. Slots are spread over shards by the low bits of the handle, each with its own
+ * allocation and update counter, so ingest threads do not share cache lines
+ */
+
+#ifndef P1STATESTORE_H
+#define P1STATESTORE_H
+
+#include <atomic>
+
+#include "P1MeterParser.h"
+#include "p1parse.h"
+
+/**
+ * @brief The hot fields of a telegram
+ *
+ */
+struct P1MeterSnapshot {
+    uint32_t Timestamp; // Seconds since 2000-01-01 local time, compared with the summer time flag so newer telegrams win across the change
+    uint32_t Delivered[2]; // Per tariff in Wh
+    uint32_t Produced[2]; // Per tariff in Wh
+    uint32_t ActualDelivered; // In W
+    uint32_t ActualProduced; // In W
+    uint16_t Voltage[3]; // In 100 mV
+    uint16_t Current[3]; // In A
+    uint32_t MBusValue; // Reading of the first M-Bus device in thousandths of its unit, e.g. dm3 gas
+    uint16_t CRC;
+    uint8_t Tariff;
+    uint8_t Flags; // P1_RECORD_ flags
+};
+
+#define STATE_SNAPSHOT_WORDS (sizeof(P1MeterSnapshot) / sizeof(uint32_t))
+
+/**
+ * @brief Sharded store of the latest snapshot per meter
+ *
+ */
+class P1StateStore {
+public:
+    P1StateStore(uint32_t capacity, uint8_t shardBits = 6);
+    ~P1StateStore();
+
+    bool Update(uint32_t handle, const P1Data &data);
+    bool Update(uint32_t handle, const P1MeterSnapshot &snapshot);
+    bool Read(uint32_t handle, P1MeterSnapshot &snapshot) const;
+
+    uint32_t Capacity() const;
+    uint64_t Updates() const;
+
+    static void MakeSnapshot(const P1Data &data, P1MeterSnapshot &snapshot);
+
+private:
+    struct alignas(64) slot {
+        std::atomic<uint32_t> sequence; // 0 when never written, odd while being written
+        std::atomic<uint32_t> words[STATE_SNAPSHOT_WORDS];
+    };
+
+    struct alignas(64) shard {
+        slot *slots;
+        std::atomic<uint64_t> updates;
+    };
+
+    slot *find(uint32_t handle) const;
+
+    uint32_t capacity;
+    uint8_t shardBits;
+    shard *shards;
+};
+
+#endif // P1STATESTORE_H
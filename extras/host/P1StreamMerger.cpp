@@ -0,0 +1,160 @@
+/**
+ * @file P1StreamMerger.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Merges the parsed telegrams of many meters into one stream ordered by time
+ * @version 0.1
+ * @date 2022-05-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1StreamMerger.h"
+
+#define MERGE_KEY_DONE 0xFFFFFFFFFFFFFFFFULL
+
+// Timestamp on a scale that keeps increasing when summer time ends, so the repeated hour is merged in order, see P1StateStore
+static inline uint32_t winterTime(const p1_record &record) {
+    return record.flags & P1_RECORD_SUMMER_TIME ? record.timestamp - 3600 : record.timestamp;
+}
+
+/**
+ * @brief Construct a new merger
+ *
+ * @param sources The streams to merge, they must stay valid while merging
+ * @param count The number of streams
+ */
+P1StreamMerger::P1StreamMerger(const P1MergeSource *sources, uint16_t count) {
+    this->sources = sources;
+    this->count = count;
+    positions = new size_t[count]();
+    keys = new uint64_t[count];
+    tree = new uint16_t[count > 0 ? count : 1]();
+    deliveredSums = new uint64_t[count]();
+    producedSums = new uint64_t[count]();
+    samples = new uint32_t[count]();
+
+    for (uint16_t i = 0; i < count; i++) {
+        loadKey(i);
+    }
+
+    // Play all matches bottom up. The leaves are at count up to 2 * count - 1, so the parent of node n is n / 2
+    uint16_t *winners = new uint16_t[2 * count];
+    for (uint16_t i = 0; i < count; i++) {
+        winners[count + i] = i;
+    }
+    for (uint16_t node = count - 1; node > 0; node--) {
+        uint16_t left = winners[2 * node], right = winners[2 * node + 1];
+        bool leftWins = keys[left] < keys[right];
+        winners[node] = leftWins ? left : right;
+        tree[node] = leftWins ? right : left;
+    }
+    if (count > 0) tree[0] = count > 1 ? winners[1] : 0;
+    delete[] winners;
+}
+
+P1StreamMerger::~P1StreamMerger() {
+    delete[] positions;
+    delete[] keys;
+    delete[] tree;
+    delete[] deliveredSums;
+    delete[] producedSums;
+    delete[] samples;
+}
+
+/**
+ * @brief Gets the oldest record of all sources
+ *
+ * @param source Receives the index of the source of the record, may be NULL
+ * @return const p1_record* The record or NULL when all sources are done
+ */
+const p1_record *P1StreamMerger::Next(uint16_t *source) {
+    if (count == 0) return NULL;
+    uint16_t winner = tree[0];
+    if (keys[winner] == MERGE_KEY_DONE) return NULL;
+
+    const p1_record *record = &sources[winner].Records[positions[winner]++];
+    loadKey(winner);
+    replay(winner);
+
+    if (bucketCallback != NULL) addToBucket(winner, *record);
+    if (source != NULL) *source = winner;
+    return record;
+}
+
+/**
+ * @brief Sums the power of all meters per time bucket while merging
+ *
+ * @param bucketSeconds The length of a bucket, e.g. INTERVAL_QUARTER_HOUR
+ * @param callback Called for every completed bucket
+ */
+void P1StreamMerger::SetBuckets(uint32_t bucketSeconds, P1BucketCallback callback) {
+    this->bucketSeconds = bucketSeconds;
+    bucketCallback = bucketSeconds > 0 ? callback : NULL;
+    bucketStarted = false;
+}
+
+/**
+ * @brief Reports the running bucket, e.g. after the last record
+ *
+ */
+void P1StreamMerger::Flush() {
+    if (!bucketStarted) return;
+
+    P1BucketRecord bucket;
+    memset(&bucket, 0, sizeof(bucket));
+    bucket.Start = bucketStart;
+    for (uint16_t i = 0; i < count; i++) {
+        if (samples[i] == 0) continue;
+        bucket.ActualDelivered += deliveredSums[i] / samples[i];
+        bucket.ActualProduced += producedSums[i] / samples[i];
+        bucket.Meters++;
+        bucket.Samples += samples[i];
+        deliveredSums[i] = producedSums[i] = samples[i] = 0;
+    }
+    bucketStarted = false;
+    bucketCallback(bucket);
+}
+
+/***************** Helper functions *****************/
+
+/**
+ * @brief Plays the matches from the leaf of source up to the root after its key changed
+ *
+ */
+void P1StreamMerger::replay(uint16_t source) {
+    uint16_t winner = source;
+    for (uint16_t node = (count + source) / 2; node > 0; node /= 2) {
+        if (keys[tree[node]] < keys[winner]) {
+            uint16_t loser = winner;
+            winner = tree[node];
+            tree[node] = loser;
+        }
+    }
+    tree[0] = winner;
+}
+
+void P1StreamMerger::loadKey(uint16_t source) {
+    const P1MergeSource &input = sources[source];
+    size_t position = positions[source];
+    if (position >= input.Count) {
+        keys[source] = MERGE_KEY_DONE;
+        return;
+    }
+
+    // The record after this one is compared next, fetch it while the caller handles this one
+    if (position + 1 < input.Count) __builtin_prefetch(&input.Records[position + 1]);
+    keys[source] = ((uint64_t)winterTime(input.Records[position]) << 16) | source;
+}
+
+void P1StreamMerger::addToBucket(uint16_t source, const p1_record &record) {
+    uint32_t timestamp = winterTime(record);
+    uint32_t start = timestamp - timestamp % bucketSeconds;
+    if (bucketStarted && start != bucketStart) Flush();
+
+    bucketStart = start;
+    bucketStarted = true;
+    deliveredSums[source] += record.actual_delivered;
+    producedSums[source] += record.actual_produced;
+    samples[source]++;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file P1StreamMerger.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Merges the parsed telegrams of many meters into one stream ordered by time
+ * @version 0.1
+ * @date 2022-05-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note A loser tree picks the oldest record of all sources with one comparison per level, so merging N sources costs
+ * log2(N) comparisons per record. Equal timestamps come out in source order. The merged stream can be summed into time buckets,
+ * e.g. the power of all meters in a building per quarter hour. Records are ordered and bucketed by winter time (local standard
+ * time), so the hour repeated at the end of summer time follows the hour before it
+ */
+
+#ifndef P1STREAMMERGER_H
+#define P1STREAMMERGER_H
+
+#include "Arduino.h"
+#include "p1parse.h"
+
+/**
+ * @brief Parsed telegrams of one meter, ordered by time
+ *
+ */
+struct P1MergeSource {
+    const p1_record *Records;
+    size_t Count;
+};
+
+/**
+ * @brief Power of all meters in a time bucket
+ *
+ */
+struct P1BucketRecord {
+    uint32_t Start; // Start of the bucket in seconds since 2000-01-01 in winter time
+    uint32_t ActualDelivered; // Sum over the meters of their average power in the bucket in W
+    uint32_t ActualProduced; // In W
+    uint16_t Meters; // Number of meters with a telegram in the bucket
+    uint32_t Samples; // Number of telegrams in the bucket
+};
+
+/**
+ * @brief Called for every completed bucket
+ *
+ * @param bucket The bucket summary
+ */
+typedef void (*P1BucketCallback)(const P1BucketRecord &bucket);
+
+/**
+ * @brief K-way merge of parsed telegram streams
+ *
+ */
+class P1StreamMerger {
+public:
+    P1StreamMerger(const P1MergeSource *sources, uint16_t count);
+    ~P1StreamMerger();
+
+    const p1_record *Next(uint16_t *source = NULL);
+    void SetBuckets(uint32_t bucketSeconds, P1BucketCallback callback);
+    void Flush();
+
+private:
+    void replay(uint16_t source);
+    void loadKey(uint16_t source);
+    void addToBucket(uint16_t source, const p1_record &record);
+
+    const P1MergeSource *sources;
+    uint16_t count;
+    size_t *positions; // Record of the key per source
+    uint64_t *keys; // Timestamp << 16 | source of the next record per source, UINT64_MAX when the source is done
+    uint16_t *tree; // Winner in tree[0], the loser of every match in the internal nodes 1 up to count - 1
+
+    P1BucketCallback bucketCallback = NULL;
+    uint32_t bucketSeconds = 0;
+    uint32_t bucketStart = 0;
+    bool bucketStarted = false;
+    uint64_t *deliveredSums; // Per source in the running bucket
+    uint64_t *producedSums;
+    uint32_t *samples;
+};
+
+#endif // P1STREAMMERGER_H
@@ -0,0 +1,369 @@
+/**
+ * @file P1TemplateCodec.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Lossless compression of raw telegrams for archiving, storing only the values that changed since the previous telegram of a meter
+ * @version 0.1
+ * @date 2022-05-21
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note A record is the varint length of its body followed by the body: a varint of the meter << 2 | kind and the payload.
+ * Raw and keyframe payloads are the input itself. A delta payload is a flags byte, the bitmap of the changed values and per
+ * changed value a varint of its zigzag encoded difference << 1 or of its length << 1 | 1 followed by the text. Without
+ * TEMPLATE_CRC_RECALCULATED the varint length and the text after the '!' follow
+ */
+
+#include "P1TemplateCodec.h"
+#include "CRC16.h"
+#include "P1Hex.h"
+
+#define TEMPLATE_RAW        0 // Not a telegram
+#define TEMPLATE_KEYFRAME   1 // Telegram stored as it is, the new template of the meter
+#define TEMPLATE_DELTA      2 // Telegram stored as the changes to the template of the meter
+
+#define TEMPLATE_CRC_RECALCULATED 0x01 // The text after the '!' is the CRC in 4 upper case hex digits and a CR LF
+
+#define VARINT_MAX_SIZE 10
+
+// Unsigned LEB128, 7 bits per byte
+static void putVarint(uint8_t *&output, uint64_t value) {
+    while (value >= 0x80) {
+        *output++ = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    *output++ = (uint8_t)value;
+}
+
+static bool getVarint(const uint8_t *&input, const uint8_t *end, uint64_t &value) {
+    value = 0;
+    for (uint8_t shift = 0; input < end && shift < 64; shift += 7) {
+        uint8_t byte = *input++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Construct a new codec
+ *
+ * @param meters The number of meters with their own template, up to 32767. Further meters share one template
+ */
+P1TemplateCodec::P1TemplateCodec(uint16_t meters) : registry(meters) {
+    if (meters > 0x7FFF) meters = 0x7FFF;
+    this->meters = meters;
+    templates = new meterTemplate *[meters + 1]();
+}
+
+P1TemplateCodec::~P1TemplateCodec() {
+    for (uint16_t i = 0; i <= meters; i++) {
+        delete templates[i];
+    }
+    delete[] templates;
+}
+
+/**
+ * @brief Encodes a telegram, from the '/' up to and including the CR LF after the CRC, or the bytes between two telegrams
+ *
+ * @param input The telegram or other data, less than BUFFER_SIZE bytes
+ * @param length The number of bytes
+ * @param output Receives the record, at least length + TEMPLATE_RECORD_MARGIN bytes
+ * @return size_t The length of the record, 0 when the input is too long
+ */
+size_t P1TemplateCodec::Encode(const char *input, size_t length, uint8_t *output) {
+    if (length >= BUFFER_SIZE) return 0;
+
+    // The body is written after room for the longest length prefix and moved in place at the end
+    uint8_t *body = output + VARINT_MAX_SIZE;
+    uint8_t *position = body;
+
+    if (length == 0 || input[0] != '/' || !tokenize(input, length, scratch)) {
+        putVarint(position, TEMPLATE_RAW);
+        memcpy(position, input, length);
+        position += length;
+    } else {
+        uint16_t meter = meterOf(scratch);
+        meterTemplate *previous = templates[meter];
+
+        if (previous == NULL || !sameLayout(*previous, scratch)) {
+            putVarint(position, ((uint64_t)meter << 2) | TEMPLATE_KEYFRAME);
+            memcpy(position, input, length);
+            position += length;
+        } else {
+            putVarint(position, ((uint64_t)meter << 2) | TEMPLATE_DELTA);
+            bool crcRecalculated = recalculatedCRC(scratch);
+            *position++ = crcRecalculated ? TEMPLATE_CRC_RECALCULATED : 0;
+
+            uint8_t *bitmap = position;
+            uint16_t bitmapSize = (scratch.fieldCount + 7) / 8;
+            memset(bitmap, 0, bitmapSize);
+            position += bitmapSize;
+
+            for (uint16_t i = 0; i < scratch.fieldCount; i++) {
+                const char *value = scratch.text + scratch.fieldStart[i];
+                const char *old = previous->text + previous->fieldStart[i];
+                uint16_t valueLength = scratch.fieldEnd[i] - scratch.fieldStart[i];
+                uint16_t oldLength = previous->fieldEnd[i] - previous->fieldStart[i];
+                if (valueLength == oldLength && memcmp(value, old, valueLength) == 0) continue;
+
+                bitmap[i / 8] |= 1 << (i % 8);
+                int64_t delta;
+                if (valueLength == oldLength && numericDelta(old, value, valueLength, delta)) {
+                    putVarint(position, (((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63)) << 1);
+                } else {
+                    putVarint(position, ((uint64_t)valueLength << 1) | 1);
+                    memcpy(position, value, valueLength);
+                    position += valueLength;
+                }
+            }
+
+            if (!crcRecalculated) {
+                putVarint(position, scratch.length - scratch.tailEnd);
+                memcpy(position, scratch.text + scratch.tailEnd, scratch.length - scratch.tailEnd);
+                position += scratch.length - scratch.tailEnd;
+            }
+        }
+        store(meter, scratch);
+    }
+
+    // Deltas are never longer than the keyframe of the same telegram, so the record fits within the margin
+    uint8_t *record = output;
+    putVarint(record, position - body);
+    memmove(record, body, position - body);
+    return record - output + (position - body);
+}
+
+/**
+ * @brief Decodes the next record
+ *
+ * @param input The records
+ * @param length The number of bytes in input
+ * @param output Receives the telegram or other data, at least BUFFER_SIZE bytes
+ * @param outputLength Receives the number of bytes in output
+ * @return size_t The number of bytes of the record, 0 when the record is incomplete or invalid
+ */
+size_t P1TemplateCodec::Decode(const uint8_t *input, size_t length, char *output, size_t &outputLength) {
+    const uint8_t *position = input, *end = input + length;
+    uint64_t bodyLength, header;
+    if (!getVarint(position, end, bodyLength) || bodyLength > (uint64_t)(end - position)) return 0;
+    end = position + bodyLength;
+    if (!getVarint(position, end, header)) return 0;
+
+    uint8_t kind = header & 0x03;
+    uint64_t meter = header >> 2;
+    size_t payloadLength = end - position;
+
+    if (kind == TEMPLATE_RAW || kind == TEMPLATE_KEYFRAME) {
+        if (payloadLength >= BUFFER_SIZE) return 0;
+        memcpy(output, position, payloadLength);
+        outputLength = payloadLength;
+        if (kind == TEMPLATE_KEYFRAME) {
+            if (meter > meters || !tokenize(output, payloadLength, scratch)) return 0;
+            store(meter, scratch);
+        }
+        return end - input;
+    }
+
+    if (kind != TEMPLATE_DELTA || meter > meters || templates[meter] == NULL || position >= end) return 0;
+    const meterTemplate &previous = *templates[meter];
+    uint8_t flags = *position++;
+    const uint8_t *bitmap = position;
+    position += (previous.fieldCount + 7) / 8;
+    if (position > end) return 0;
+
+    // Literal text of the template with the values in between
+    uint16_t outputIndex = 0, literalStart = 0;
+    for (uint16_t i = 0; i <= previous.fieldCount; i++) {
+        uint16_t literalEnd = i < previous.fieldCount ? previous.fieldStart[i] : previous.tailEnd;
+        if (outputIndex + literalEnd - literalStart >= BUFFER_SIZE) return 0;
+        memcpy(output + outputIndex, previous.text + literalStart, literalEnd - literalStart);
+        outputIndex += literalEnd - literalStart;
+        if (i == previous.fieldCount) break;
+
+        const char *old = previous.text + previous.fieldStart[i];
+        uint16_t oldLength = previous.fieldEnd[i] - previous.fieldStart[i];
+        literalStart = previous.fieldEnd[i];
+
+        if (outputIndex + oldLength >= BUFFER_SIZE) return 0;
+        if ((bitmap[i / 8] & (1 << (i % 8))) == 0) {
+            memcpy(output + outputIndex, old, oldLength);
+            outputIndex += oldLength;
+            continue;
+        }
+
+        uint64_t change;
+        if (!getVarint(position, end, change)) return 0;
+        if (change & 1) {
+            uint64_t valueLength = change >> 1;
+            if (valueLength > (uint64_t)(end - position) || outputIndex + valueLength >= BUFFER_SIZE) return 0;
+            memcpy(output + outputIndex, position, valueLength);
+            position += valueLength;
+            outputIndex += valueLength;
+        } else {
+            uint64_t zigzag = change >> 1;
+            int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+            memcpy(output + outputIndex, old, oldLength);
+            if (!applyDelta(output + outputIndex, oldLength, delta)) return 0;
+            outputIndex += oldLength;
+        }
+    }
+
+    if (flags & TEMPLATE_CRC_RECALCULATED) {
+        if (outputIndex + 6 >= BUFFER_SIZE) return 0;
+        char crc[7];
+        snprintf(crc, sizeof(crc), "%04X\r\n", CRC16_IBM_REVERSED(output, outputIndex));
+        memcpy(output + outputIndex, crc, 6);
+        outputIndex += 6;
+    } else {
+        uint64_t restLength;
+        if (!getVarint(position, end, restLength) || restLength > (uint64_t)(end - position) || outputIndex + restLength >= BUFFER_SIZE) return 0;
+        memcpy(output + outputIndex, position, restLength);
+        position += restLength;
+        outputIndex += restLength;
+    }
+
+    outputLength = outputIndex;
+    if (!tokenize(output, outputIndex, scratch)) return 0;
+    store(meter, scratch);
+    return end - input;
+}
+
+/***************** Helper functions *****************/
+
+/**
+ * @brief Finds the values of a telegram: the text between every '(' and ')' before the '!' line
+ *
+ * @return bool False when the telegram has no '!' line, a value is not closed or has too many values
+ */
+bool P1TemplateCodec::tokenize(const char *text, uint16_t length, meterTemplate &telegram) {
+    const char *end = text + length;
+    const char *bang = end - 1;
+    while (bang > text && !(*bang == '!' && bang[-1] == '\n')) bang--;
+    if (bang == text) return false;
+
+    telegram.fieldCount = 0;
+    for (const char *open = (const char *)memchr(text, '(', bang - text); open != NULL;
+         open = (const char *)memchr(open, '(', bang - open)) {
+        const char *close = (const char *)memchr(open + 1, ')', bang - open - 1);
+        if (close == NULL || telegram.fieldCount == TEMPLATE_MAX_FIELDS) return false;
+
+        telegram.fieldStart[telegram.fieldCount] = open + 1 - text;
+        telegram.fieldEnd[telegram.fieldCount] = close - text;
+        telegram.fieldCount++;
+        open = close;
+    }
+
+    telegram.tailEnd = bang + 1 - text;
+    telegram.length = length;
+    if (text != telegram.text) memcpy(telegram.text, text, length);
+    return true;
+}
+
+/**
+ * @brief Checks whether the text outside the values is the same
+ *
+ */
+bool P1TemplateCodec::sameLayout(const meterTemplate &previous, const meterTemplate &telegram) {
+    if (previous.fieldCount != telegram.fieldCount) return false;
+
+    uint16_t previousStart = 0, start = 0;
+    for (uint16_t i = 0; i <= telegram.fieldCount; i++) {
+        uint16_t previousEnd = i < previous.fieldCount ? previous.fieldStart[i] : previous.tailEnd;
+        uint16_t end = i < telegram.fieldCount ? telegram.fieldStart[i] : telegram.tailEnd;
+        if (previousEnd - previousStart != end - start) return false;
+        if (memcmp(previous.text + previousStart, telegram.text + start, end - start) != 0) return false;
+
+        if (i < telegram.fieldCount) {
+            previousStart = previous.fieldEnd[i];
+            start = telegram.fieldEnd[i];
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Calculates the difference of two values of the same format: digits with the '.' at the same place and the same text
+ * after them, e.g. 012345.678*kWh and 012346.001*kWh or the timestamps 220307202640W and 220307202650W
+ *
+ * @return bool False when the format differs
+ */
+bool P1TemplateCodec::numericDelta(const char *previous, const char *value, uint16_t length, int64_t &delta) {
+    int64_t previousNumber = 0, number = 0;
+    uint8_t digits = 0;
+    uint16_t i = 0;
+    for (; i < length; i++) {
+        bool previousDigit = previous[i] >= '0' && previous[i] <= '9';
+        bool digit = value[i] >= '0' && value[i] <= '9';
+        if (previousDigit != digit) return false;
+        if (digit) {
+            if (++digits > 18) return false;
+            previousNumber = previousNumber * 10 + previous[i] - '0';
+            number = number * 10 + value[i] - '0';
+        } else if (previous[i] != '.' || value[i] != '.') {
+            break;
+        }
+    }
+    if (digits == 0 || memcmp(previous + i, value + i, length - i) != 0) return false;
+
+    delta = number - previousNumber;
+    return true;
+}
+
+/**
+ * @brief Adds the difference to the digits of a value in place, keeping its width
+ *
+ * @return bool False when the result does not fit in the digits
+ */
+bool P1TemplateCodec::applyDelta(char *value, uint16_t length, int64_t delta) {
+    int64_t number = 0;
+    uint16_t end = 0;
+    for (; end < length && ((value[end] >= '0' && value[end] <= '9') || value[end] == '.'); end++) {
+        if (value[end] != '.') number = number * 10 + value[end] - '0';
+    }
+
+    number += delta;
+    if (number < 0) return false;
+    for (uint16_t i = end; i > 0; i--) {
+        if (value[i - 1] == '.') continue;
+        value[i - 1] = '0' + number % 10;
+        number /= 10;
+    }
+    return number == 0;
+}
+
+/**
+ * @brief Checks whether the text after the '!' is the CRC of the telegram as the decoder would write it
+ *
+ */
+bool P1TemplateCodec::recalculatedCRC(const meterTemplate &telegram) {
+    if (telegram.length - telegram.tailEnd != 6) return false;
+
+    char crc[7];
+    snprintf(crc, sizeof(crc), "%04X\r\n", CRC16_IBM_REVERSED(telegram.text, telegram.tailEnd));
+    return memcmp(crc, telegram.text + telegram.tailEnd, 6) == 0;
+}
+
+/**
+ * @brief Gets the template of a telegram by its equipment identifier
+ *
+ */
+uint16_t P1TemplateCodec::meterOf(const meterTemplate &telegram) {
+    static const char EQUIPMENT_ID_CODE[] = "0-0:96.1.1(";
+    const uint8_t codeLength = sizeof(EQUIPMENT_ID_CODE) - 1;
+
+    for (uint16_t i = 0; i < telegram.fieldCount; i++) {
+        uint16_t start = telegram.fieldStart[i];
+        if (start < codeLength || memcmp(telegram.text + start - codeLength, EQUIPMENT_ID_CODE, codeLength) != 0) continue;
+
+        char equipmentID[P1_EQUIPMENT_ID_SIZE];
+        P1DecodeHex(telegram.text + start, telegram.fieldEnd[i] - start, equipmentID, P1_EQUIPMENT_ID_SIZE);
+        uint16_t handle = registry.Intern(equipmentID);
+        return handle == EQUIPMENT_HANDLE_NONE ? meters : handle;
+    }
+    return meters;
+}
+
+void P1TemplateCodec::store(uint16_t meter, const meterTemplate &telegram) {
+    if (templates[meter] == NULL) templates[meter] = new meterTemplate;
+    *templates[meter] = telegram;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file P1TemplateCodec.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Lossless compression of raw telegrams for archiving, storing only the values that changed since the previous telegram of a meter
+ * @version 0.1
+ * @date 2022-05-21
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The first telegram of a meter is stored as it is and becomes its template: the text outside the parentheses (header,
+ * OBIS codes, layout) and the values inside them. A following telegram with the same text outside the parentheses is stored as a
+ * bitmap of the values that changed, each as the difference of its digits or as text when its format changed. A CRC matching the
+ * content is recalculated instead of stored. Anything else, e.g. bytes between telegrams, is stored as it is, so the input is
+ * reconstructed byte for byte. Encoder and decoder each need their own instance, fed with the same sequence
+ */
+
+#ifndef P1TEMPLATECODEC_H
+#define P1TEMPLATECODEC_H
+
+#include "P1EquipmentRegistry.h"
+
+#define TEMPLATE_MAX_FIELDS     128 // Telegrams with more values are always stored as they are
+#define TEMPLATE_RECORD_MARGIN  16 // Encoded records are at most this much longer than the input
+
+/**
+ * @brief Template diff encoder and decoder
+ *
+ */
+class P1TemplateCodec {
+public:
+    P1TemplateCodec(uint16_t meters);
+    ~P1TemplateCodec();
+
+    size_t Encode(const char *input, size_t length, uint8_t *output);
+    size_t Decode(const uint8_t *input, size_t length, char *output, size_t &outputLength);
+
+private:
+    struct meterTemplate {
+        char text[BUFFER_SIZE]; // The previous telegram
+        uint16_t length;
+        uint16_t fieldCount;
+        uint16_t fieldStart[TEMPLATE_MAX_FIELDS]; // First character after the '('
+        uint16_t fieldEnd[TEMPLATE_MAX_FIELDS]; // The ')'
+        uint16_t tailEnd; // Up to and including the '!'
+    };
+
+    static bool tokenize(const char *text, uint16_t length, meterTemplate &telegram);
+    static bool sameLayout(const meterTemplate &previous, const meterTemplate &telegram);
+    static bool numericDelta(const char *previous, const char *value, uint16_t length, int64_t &delta);
+    static bool applyDelta(char *value, uint16_t length, int64_t delta);
+    static bool recalculatedCRC(const meterTemplate &telegram);
+    uint16_t meterOf(const meterTemplate &telegram);
+    void store(uint16_t meter, const meterTemplate &telegram);
+
+    P1EquipmentRegistry registry;
+    uint16_t meters; // Handles of the registry, plus one template for telegrams without equipment identifier
+    meterTemplate **templates;
+    meterTemplate scratch; // The telegram being encoded or decoded
+};
+
+#endif // P1TEMPLATECODEC_H
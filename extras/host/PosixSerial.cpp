@@ -0,0 +1,93 @@
+/**
+ * @file PosixSerial.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief HardwareSerial on a POSIX file descriptor (serial port, pseudo terminal or pipe) for the host builds
+ * @version 0.1
+ * @date 2022-03-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "PosixSerial.h"
+
+/**
+ * @brief Construct a serial port on an open file descriptor. The descriptor is switched to non-blocking
+ *
+ * @param fd The file descriptor
+ */
+PosixSerial::PosixSerial(int fd) {
+    this->fd = fd;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/**
+ * @brief Opens and configures a serial device in raw mode
+ *
+ * @param path The device, e.g. /dev/ttyUSB0 or a pseudo terminal
+ * @param baudRate 115200 for DSMR 4 and 5 or 9600 for DSMR 2.2 and 3.0
+ * @param sevenBitsEvenParity True for the 7E1 setting of DSMR 2.2 and 3.0, false for 8N1
+ * @return int The file descriptor or -1 on failure
+ */
+int PosixSerial::Open(const char *path, uint32_t baudRate, bool sevenBitsEvenParity) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+
+    struct termios settings;
+    if (tcgetattr(fd, &settings) == 0) {
+        cfmakeraw(&settings);
+        speed_t speed = baudRate == 9600 ? B9600 : (baudRate == 57600 ? B57600 : B115200);
+        cfsetispeed(&settings, speed);
+        cfsetospeed(&settings, speed);
+        if (sevenBitsEvenParity) {
+            settings.c_cflag = (settings.c_cflag & ~CSIZE) | CS7 | PARENB;
+            settings.c_iflag |= ISTRIP;
+        }
+        tcsetattr(fd, TCSANOW, &settings);
+    }
+    return fd;
+}
+
+int PosixSerial::available() {
+    if (head == tail) fill();
+    return tail - head;
+}
+
+int PosixSerial::read() {
+    if (head == tail) fill();
+    if (head == tail) return -1;
+    return buffer[head++];
+}
+
+int PosixSerial::peek() {
+    if (head == tail) fill();
+    if (head == tail) return -1;
+    return buffer[head];
+}
+
+size_t PosixSerial::write(uint8_t value) {
+    return write(&value, 1);
+}
+
+size_t PosixSerial::write(const uint8_t *data, size_t size) {
+    ssize_t written = ::write(fd, data, size);
+    return written < 0 ? 0 : written;
+}
+
+
+/***************** Helper functions *****************/
+
+void PosixSerial::fill() {
+    head = tail = 0;
+    ssize_t received = ::read(fd, buffer, POSIX_SERIAL_BUFFER_SIZE);
+    if (received > 0) {
+        tail = received;
+    } else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        EndOfFile = true; // EIO on a pseudo terminal without writer, 0 at the end of a file or pipe
+    }
+}
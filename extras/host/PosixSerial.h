@@ -0,0 +1,46 @@
+/**
+ * @file PosixSerial.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief HardwareSerial on a POSIX file descriptor (serial port, pseudo terminal or pipe) for the host builds
+ * @version 0.1
+ * @date 2022-03-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef POSIXSERIAL_H
+#define POSIXSERIAL_H
+
+#include "Arduino.h"
+
+#define POSIX_SERIAL_BUFFER_SIZE 4096
+
+/**
+ * @brief Non-blocking serial port on a file descriptor, reading in blocks like the UART FIFO of a board
+ *
+ */
+class PosixSerial : public HardwareSerial {
+public:
+    PosixSerial(int fd);
+
+    static int Open(const char *path, uint32_t baudRate, bool sevenBitsEvenParity = false);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+
+    bool EndOfFile = false; // The other side closed the connection
+
+private:
+    void fill();
+
+    int fd;
+    uint8_t buffer[POSIX_SERIAL_BUFFER_SIZE];
+    size_t head = 0;
+    size_t tail = 0;
+};
+
+#endif // POSIXSERIAL_H
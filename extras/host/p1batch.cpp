@@ -0,0 +1,120 @@
+/**
+ * @file p1batch.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Parses a file of concatenated telegrams, e.g. from p1gen, through the C interface and reports the throughput
+ * @version 0.1
+ * @date 2022-04-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Usage: p1batch [-b records per call] [-c] [-d window seconds] [-v] file
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "p1parse.h"
+
+int main(int argc, char **argv) {
+    size_t batch = 4096;
+    uint32_t dedupWindow = 0;
+    bool verbose = false, columnar = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "b:cd:v")) != -1) {
+        switch (option) {
+        case 'b': batch = strtoul(optarg, NULL, 10); break;
+        case 'c': columnar = true; break;
+        case 'd': dedupWindow = strtoul(optarg, NULL, 10); break;
+        case 'v': verbose = true; break;
+        default: break;
+        }
+    }
+    if (optind >= argc || batch == 0) {
+        fprintf(stderr, "Usage: %s [-b records] [-c] [-d seconds] [-v] file\n  -b  records per call, default 4096\n  -c  parse the energy and power columns only\n  -d  skip duplicate telegrams within windows of this length\n  -v  print every record\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[optind], "rb");
+    if (file == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *input = (uint8_t *)malloc(length);
+    if (input == NULL || fread(input, 1, length, file) != length) {
+        fprintf(stderr, "Could not read %s\n", argv[optind]);
+        return 1;
+    }
+    fclose(file);
+
+    if (p1_abi_version() != P1_ABI_VERSION || p1_record_size() != sizeof(p1_record)) {
+        fprintf(stderr, "Library does not match p1parse.h\n");
+        return 1;
+    }
+
+    p1_record *records = (p1_record *)malloc(batch * sizeof(p1_record));
+    p1_columns columns;
+    memset(&columns, 0, sizeof(columns));
+    uint8_t *validCRC = (uint8_t *)malloc((batch + 7) / 8);
+    if (columnar) {
+        static const uint8_t wanted[] = { P1_COLUMN_TIMESTAMP, P1_COLUMN_DELIVERED_TARIFF1, P1_COLUMN_DELIVERED_TARIFF2,
+                                          P1_COLUMN_ACTUAL_DELIVERED, P1_COLUMN_ACTUAL_PRODUCED, P1_COLUMN_MBUS_VALUE };
+        for (uint8_t i = 0; i < sizeof(wanted); i++) columns.columns[wanted[i]] = (uint32_t *)malloc(batch * sizeof(uint32_t));
+        columns.valid_crc = validCRC;
+    }
+    size_t position = 0, telegrams = 0, valid = 0, calls = 0, duplicates = 0;
+    p1_dedup *dedup = dedupWindow > 0 ? p1_dedup_create(dedupWindow, 32767) : NULL;
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (position < length) {
+        size_t consumed;
+        size_t count;
+        if (columnar) {
+            count = p1_parse_columns(input + position, length - position, &columns, batch, &consumed);
+        } else if (dedup != NULL) {
+            count = p1_parse_stream_unique(dedup, input + position, length - position, records, batch, &consumed, &duplicates);
+        } else {
+            count = p1_parse_stream(input + position, length - position, records, batch, &consumed);
+        }
+        calls++;
+
+        for (size_t i = 0; columnar && i < count; i++) {
+            bool crc = validCRC[i / 8] >> (i % 8) & 1;
+            valid += crc;
+            if (verbose) {
+                printf("%zu %u CRC %s, %u W, gas %u\n", telegrams + i + 1, columns.columns[P1_COLUMN_TIMESTAMP][i], crc ? "valid" : "invalid",
+                       columns.columns[P1_COLUMN_ACTUAL_DELIVERED][i], columns.columns[P1_COLUMN_MBUS_VALUE][i]);
+            }
+        }
+        for (size_t i = 0; !columnar && i < count; i++) {
+            valid += records[i].flags & P1_RECORD_VALID_CRC;
+            if (verbose) {
+                printf("%zu %u %s CRC %s, %u W, gas %u\n", telegrams + i + 1, records[i].timestamp, records[i].equipment_id,
+                       records[i].flags & P1_RECORD_VALID_CRC ? "valid" : "invalid", records[i].actual_delivered, records[i].mbus[0].value);
+            }
+        }
+        telegrams += count;
+
+        if (consumed == 0) break; // Only an incomplete telegram left
+        position += consumed;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    double seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%zu telegrams, %zu valid CRC, %zu duplicates skipped, %zu calls in %.3f s: %.0f telegrams/s, %.1f MB/s\n",
+            telegrams, valid, duplicates, calls, seconds, telegrams / seconds, position / seconds / 1e6);
+
+    if (dedup != NULL) p1_dedup_destroy(dedup);
+    for (uint8_t i = 0; i < P1_COLUMN_COUNT; i++) free(columns.columns[i]);
+    free(validCRC);
+    free(records);
+    free(input);
+    return 0;
+}
@@ -0,0 +1,262 @@
+/**
+ * @file p1bench.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Compares the column kernels of P1ColumnKernels with plain loops over arrays of P1Data, checking they give the same results
+ * @version 0.1
+ * @date 2022-06-04
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Usage: p1bench [-r rows] [-b bucket seconds] file. The telegrams of the file, e.g. from p1gen, are repeated up to the number
+ * of rows, each repetition later in time
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "P1ColumnKernels.h"
+#include "P1Framing.h"
+#include "P1Register.h"
+
+#define BENCH_HISTOGRAM_LOW     2000 // 200 V in 100 mV
+#define BENCH_HISTOGRAM_WIDTH   10 // 1 V
+#define BENCH_HISTOGRAM_BINS    64
+
+static const uint8_t benchColumns[] = { Column_DateTime, Column_DeliveredTariff1, Column_ActualDelivered, Column_VoltageL1, Column_VoltageL2,
+                                        Column_VoltageL3 };
+
+static double elapsed(const struct timespec &start) {
+    struct timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    return (stop.tv_sec - start.tv_sec) * 1e3 + (stop.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static bool mismatch = false;
+
+static void report(const char *name, double naive, double kernel, bool same) {
+    mismatch |= !same;
+    printf("%-28s naive %8.2f ms  %-6s %8.2f ms  %5.1fx%s\n", name, naive, P1ColumnKernelName(), kernel, naive / kernel, same ? "" : "  MISMATCH");
+}
+
+static bool sameStats(const P1ColumnStats &a, const P1ColumnStats &b) {
+    return a.Sum == b.Sum && a.Min == b.Min && a.Max == b.Max && a.Count == b.Count;
+}
+
+/**
+ * @brief Parses every telegram into a P1Data and a row of the columns, up to capacity
+ *
+ * @return size_t The number of telegrams
+ */
+static size_t parseFile(const char *input, size_t length, P1Data *data, P1ColumnBatch &batch, size_t capacity) {
+    P1Meter meter(NULL);
+    size_t count = 0;
+    const char *position = input, *end = input + length;
+    while (count < capacity && position < end) {
+        const char *start = (const char *)memchr(position, '/', end - position);
+        if (start == NULL) break;
+        const char *last = P1TelegramEnd(start, end);
+        if (last == NULL) {
+            position = start + 1;
+            continue;
+        }
+
+        meter.LoadTelegram(start, last + 1 - start);
+        data[count] = meter.ProcessTelegram();
+        meter.LoadTelegram(start, last + 1 - start);
+        meter.ProcessTelegram(batch, count);
+        count++;
+        position = last + 1;
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    size_t rows = 1000000;
+    uint32_t bucketSeconds = 900;
+
+    int option;
+    while ((option = getopt(argc, argv, "r:b:")) != -1) {
+        switch (option) {
+        case 'r': rows = strtoul(optarg, NULL, 10); break;
+        case 'b': bucketSeconds = strtoul(optarg, NULL, 10); break;
+        default: break;
+        }
+    }
+    if (optind >= argc || rows == 0 || bucketSeconds == 0) {
+        fprintf(stderr, "Usage: %s [-r rows] [-b seconds] file\n  -r  rows to aggregate, default 1000000\n  -b  length of the time buckets, default 900\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[optind], "rb");
+    if (file == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *input = (char *)malloc(length);
+    if (input == NULL || fread(input, 1, length, file) != length) {
+        fprintf(stderr, "Could not read %s\n", argv[optind]);
+        return 1;
+    }
+    fclose(file);
+
+    P1Data *data = new P1Data[rows];
+    P1ColumnBatch batch;
+    memset(&batch, 0, sizeof(batch));
+    for (uint8_t i = 0; i < sizeof(benchColumns); i++) {
+        batch.Columns[benchColumns[i]] = new uint32_t[rows];
+        batch.Valid[benchColumns[i]] = new uint8_t[(rows + 7) / 8]();
+    }
+
+    size_t telegrams = parseFile(input, length, data, batch, rows);
+    free(input);
+    if (telegrams == 0) {
+        fprintf(stderr, "No telegrams in %s\n", argv[optind]);
+        return 1;
+    }
+
+    // The bucket kernels need the rows in time order, as in the archive of one meter
+    uint32_t *timestamps = batch.Columns[Column_DateTime];
+    for (size_t row = 1; row < telegrams; row++) {
+        if (timestamps[row] < timestamps[row - 1]) {
+            fprintf(stderr, "The telegrams of %s are not in time order at telegram %zu\n", argv[optind], row + 1);
+            return 1;
+        }
+    }
+
+    // Repeat the telegrams, shifted by the time they span
+    uint32_t first = timestamps[0], span = timestamps[telegrams - 1] - first + 1;
+    for (size_t row = telegrams; row < rows; row++) {
+        size_t source = row % telegrams;
+        uint32_t shift = (row / telegrams) * span;
+        data[row] = data[source];
+        P1SecondsToDateTime(P1DateTimeToSeconds(data[source].DateTime) + shift, data[row].DateTime, data[source].DateTime[12] == 'S');
+        for (uint8_t i = 0; i < sizeof(benchColumns); i++) {
+            uint8_t column = benchColumns[i];
+            batch.Columns[column][row] = batch.Columns[column][source] + (column == Column_DateTime ? shift : 0);
+            if (batch.Valid[column][source / 8] >> (source % 8) & 1) batch.Valid[column][row / 8] |= 1 << (row % 8);
+        }
+    }
+    printf("%zu telegrams repeated to %zu rows, P1Data %zu bytes, row of the columns %zu bytes\n", telegrams, rows, sizeof(P1Data),
+           sizeof(benchColumns) * sizeof(uint32_t));
+
+    struct timespec start;
+    double naive, kernel;
+
+    // Sum, minimum and maximum of the power
+    P1ColumnStats naiveStats, kernelStats;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t row = 0; row < rows; row++) {
+        uint32_t value = data[row].ActualDelivered;
+        naiveStats.Sum += value;
+        if (value < naiveStats.Min) naiveStats.Min = value;
+        if (value > naiveStats.Max) naiveStats.Max = value;
+        naiveStats.Count++;
+    }
+    naive = elapsed(start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    kernelStats = P1ColumnAggregate(batch.Columns[Column_ActualDelivered], batch.Valid[Column_ActualDelivered], 0, rows);
+    kernel = elapsed(start);
+    report("actual delivered", naive, kernel, sameStats(naiveStats, kernelStats));
+
+    // The same per phase voltage
+    P1ColumnStats naivePhases[3], kernelPhases[3];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t row = 0; row < rows; row++) {
+        for (uint8_t phase = 0; phase < 3; phase++) {
+            uint32_t value = data[row].Voltage[phase];
+            if (value == 0) continue; // Not reported, no valid row in the column
+            naivePhases[phase].Sum += value;
+            if (value < naivePhases[phase].Min) naivePhases[phase].Min = value;
+            if (value > naivePhases[phase].Max) naivePhases[phase].Max = value;
+            naivePhases[phase].Count++;
+        }
+    }
+    naive = elapsed(start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        kernelPhases[phase] = P1ColumnAggregate(batch.Columns[Column_VoltageL1 + phase], batch.Valid[Column_VoltageL1 + phase], 0, rows);
+    }
+    kernel = elapsed(start);
+    report("voltage L1-L3", naive, kernel,
+           sameStats(naivePhases[0], kernelPhases[0]) && sameStats(naivePhases[1], kernelPhases[1]) && sameStats(naivePhases[2], kernelPhases[2]));
+
+    // Increases of the energy register
+    uint64_t naiveEnergy = 0, kernelEnergy;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t row = 1; row < rows; row++) {
+        naiveEnergy += P1RegisterDelta(data[row].DeliveredTariff1, data[row - 1].DeliveredTariff1);
+    }
+    naive = elapsed(start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    kernelEnergy = P1ColumnDeltas(batch.Columns[Column_DeliveredTariff1], batch.Valid[Column_DeliveredTariff1], 0, rows, NULL);
+    kernel = elapsed(start);
+    report("delivered tariff 1 deltas", naive, kernel, naiveEnergy == kernelEnergy);
+
+    // Histogram of the voltage of L1
+    uint32_t naiveBins[BENCH_HISTOGRAM_BINS] = {}, kernelBins[BENCH_HISTOGRAM_BINS] = {};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t row = 0; row < rows; row++) {
+        uint32_t value = data[row].Voltage[0];
+        if (value == 0) continue;
+        uint32_t bin = value > BENCH_HISTOGRAM_LOW ? (value - BENCH_HISTOGRAM_LOW) / BENCH_HISTOGRAM_WIDTH : 0;
+        naiveBins[bin < BENCH_HISTOGRAM_BINS ? bin : BENCH_HISTOGRAM_BINS - 1]++;
+    }
+    naive = elapsed(start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    P1ColumnHistogram(batch.Columns[Column_VoltageL1], batch.Valid[Column_VoltageL1], 0, rows, BENCH_HISTOGRAM_LOW, BENCH_HISTOGRAM_WIDTH,
+                      kernelBins, BENCH_HISTOGRAM_BINS);
+    kernel = elapsed(start);
+    report("voltage L1 histogram", naive, kernel, memcmp(naiveBins, kernelBins, sizeof(naiveBins)) == 0);
+
+    // Power and energy per time bucket
+    uint32_t bucketStart = first - first % bucketSeconds;
+    size_t bucketCount = (timestamps[rows - 1] - bucketStart) / bucketSeconds + 1;
+    P1ColumnStats *naiveBuckets = new P1ColumnStats[bucketCount](), *kernelBuckets = new P1ColumnStats[bucketCount]();
+    uint64_t *naiveEnergyBuckets = new uint64_t[bucketCount](), *kernelEnergyBuckets = new uint64_t[bucketCount]();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t row = 0; row < rows; row++) {
+        P1ColumnStats &bucket = naiveBuckets[(P1DateTimeToSeconds(data[row].DateTime) - bucketStart) / bucketSeconds];
+        uint32_t value = data[row].ActualDelivered;
+        bucket.Sum += value;
+        if (value < bucket.Min) bucket.Min = value;
+        if (value > bucket.Max) bucket.Max = value;
+        bucket.Count++;
+    }
+    naive = elapsed(start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    P1ColumnAggregateBuckets(timestamps, batch.Columns[Column_ActualDelivered], batch.Valid[Column_ActualDelivered], rows, bucketStart, bucketSeconds,
+                             kernelBuckets, bucketCount);
+    kernel = elapsed(start);
+    bool same = true;
+    for (size_t i = 0; i < bucketCount; i++) same &= sameStats(naiveBuckets[i], kernelBuckets[i]);
+    report("actual delivered buckets", naive, kernel, same);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t row = 1; row < rows; row++) {
+        naiveEnergyBuckets[(P1DateTimeToSeconds(data[row].DateTime) - bucketStart) / bucketSeconds] +=
+            P1RegisterDelta(data[row].DeliveredTariff1, data[row - 1].DeliveredTariff1);
+    }
+    naive = elapsed(start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    P1ColumnDeltaBuckets(timestamps, batch.Columns[Column_DeliveredTariff1], batch.Valid[Column_DeliveredTariff1], rows, bucketStart, bucketSeconds,
+                         kernelEnergyBuckets, bucketCount);
+    kernel = elapsed(start);
+    report("delivered deltas buckets", naive, kernel, memcmp(naiveEnergyBuckets, kernelEnergyBuckets, bucketCount * sizeof(uint64_t)) == 0);
+
+    delete[] naiveBuckets;
+    delete[] kernelBuckets;
+    delete[] naiveEnergyBuckets;
+    delete[] kernelEnergyBuckets;
+    for (uint8_t i = 0; i < sizeof(benchColumns); i++) {
+        delete[] batch.Columns[benchColumns[i]];
+        delete[] batch.Valid[benchColumns[i]];
+    }
+    delete[] data;
+    return mismatch ? 2 : 0;
+}
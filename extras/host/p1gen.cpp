@@ -0,0 +1,114 @@
+/**
+ * @file p1gen.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Writes generated telegrams to stdout, a file, a pipe or a pseudo terminal for load testing
+ * @version 0.1
+ * @date 2022-03-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Usage: p1gen [-v version] [-1] [-m mbus devices] [-l power failure logs] [-t text] [-s] [-n count] [-r telegrams per second] [-o path | -p]
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "P1TelegramGenerator.h"
+
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+static int openPseudoTerminal() {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pseudo terminal");
+        exit(1);
+    }
+
+    // Keep the slave open in raw mode so the \r\n line endings pass unchanged and writes don't fail before a reader connects
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    struct termios settings;
+    tcgetattr(slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+
+    fprintf(stderr, "Meter available on %s\n", ptsname(master));
+    return master;
+}
+
+static void writeAll(int output, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(output, data, length);
+        if (written <= 0) {
+            perror("write");
+            exit(1);
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+int main(int argc, char **argv) {
+    P1GeneratorConfig config;
+    unsigned long count = 0, rate = 0;
+    int output = STDOUT_FILENO;
+
+    int option;
+    while ((option = getopt(argc, argv, "v:1m:l:t:sn:r:o:pS:")) != -1) {
+        switch (option) {
+        case 'v': config.Version = atoi(optarg); break;
+        case '1': config.NumberOfPhases = 1; break;
+        case 'm': config.NumberOfMBusDevices = atoi(optarg); break;
+        case 'l': config.NumberOfPowerFailureLogs = atoi(optarg); break;
+        case 't': config.TextMessage = optarg; break;
+        case 's': config.Production = true; break;
+        case 'S': config.Seed = strtoul(optarg, NULL, 10); break;
+        case 'n': count = strtoul(optarg, NULL, 10); break;
+        case 'r': rate = strtoul(optarg, NULL, 10); break;
+        case 'o':
+            output = open(optarg, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (output < 0) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        case 'p': output = openPseudoTerminal(); break;
+        default:
+            fprintf(stderr, "Usage: %s [-v version] [-1] [-m mbus devices] [-l logs] [-t text] [-s] [-S seed] [-n count] [-r telegrams/s] [-o path | -p]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    P1TelegramGenerator generator(config);
+    char *buffer = (char *)malloc(OUTPUT_BUFFER_SIZE);
+    if (buffer == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    size_t used = 0;
+    unsigned long start = micros();
+
+    for (unsigned long sent = 0; count == 0 || sent < count; sent++) {
+        if (OUTPUT_BUFFER_SIZE - used < 2048 || (rate != 0 && used > 0)) {
+            writeAll(output, buffer, used);
+            used = 0;
+        }
+
+        if (rate != 0) { // Pace the telegrams, sleeping until the next one is due
+            unsigned long due = start + (unsigned long)((unsigned long long)sent * 1000000ULL / rate);
+            long wait = (long)(due - micros());
+            if (wait > 0) usleep(wait);
+        }
+
+        used += generator.Next(buffer + used, 2048);
+    }
+    writeAll(output, buffer, used);
+    free(buffer);
+
+    unsigned long elapsed = micros() - start;
+    if (count != 0 && elapsed != 0) {
+        fprintf(stderr, "%lu telegrams in %.3f s, %.0f telegrams/s\n", count, elapsed / 1e6, count * 1e6 / elapsed);
+    }
+    return 0;
+}
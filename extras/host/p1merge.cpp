@@ -0,0 +1,112 @@
+/**
+ * @file p1merge.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Merges the telegram archives of several meters into one time ordered stream and sums their power per time bucket
+ * @version 0.1
+ * @date 2022-05-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Usage: p1merge [-b bucket seconds] [-v] file... Every file holds the concatenated telegrams of one meter, e.g. from p1gen.
+ * The buckets are printed as CSV: start, delivered W, produced W, meters, telegrams
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "P1StreamMerger.h"
+
+static void printBucket(const P1BucketRecord &bucket) {
+    printf("%u,%u,%u,%u,%u\n", bucket.Start, bucket.ActualDelivered, bucket.ActualProduced, bucket.Meters, bucket.Samples);
+}
+
+/**
+ * @brief Parses a whole archive, mapped into memory so the parser reads it straight from the page cache
+ *
+ * @return bool False when the file could not be read
+ */
+static bool parseArchive(const char *path, P1MergeSource &source) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        perror(path);
+        return false;
+    }
+
+    size_t length = info.st_size;
+    const uint8_t *input = length > 0 ? (const uint8_t *)mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (input == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+    if (input != NULL) madvise((void *)input, length, MADV_SEQUENTIAL);
+
+    size_t capacity = 1024, count = 0, position = 0;
+    p1_record *records = (p1_record *)malloc(capacity * sizeof(p1_record));
+    while (position < length) {
+        if (count == capacity) {
+            capacity *= 2;
+            records = (p1_record *)realloc(records, capacity * sizeof(p1_record));
+        }
+
+        size_t consumed;
+        size_t parsed = p1_parse_stream(input + position, length - position, records + count, capacity - count, &consumed);
+        count += parsed;
+        position += consumed;
+        if (parsed == 0) break; // Only an incomplete telegram left
+    }
+    if (input != NULL) munmap((void *)input, length);
+
+    source.Records = records;
+    source.Count = count;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t bucketSeconds = 900;
+    bool verbose = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "b:v")) != -1) {
+        switch (option) {
+        case 'b': bucketSeconds = strtoul(optarg, NULL, 10); break;
+        case 'v': verbose = true; break;
+        default: break;
+        }
+    }
+    int files = argc - optind;
+    if (files <= 0 || files > 0xFFFF) {
+        fprintf(stderr, "Usage: %s [-b seconds] [-v] file...\n  -b  bucket length, default 900, 0 for none\n  -v  print every merged record\n", argv[0]);
+        return 1;
+    }
+
+    P1MergeSource *sources = new P1MergeSource[files];
+    for (int i = 0; i < files; i++) {
+        if (!parseArchive(argv[optind + i], sources[i])) return 1;
+    }
+
+    P1StreamMerger merger(sources, files);
+    merger.SetBuckets(bucketSeconds, printBucket);
+
+    const p1_record *record;
+    uint16_t source;
+    size_t merged = 0;
+    while ((record = merger.Next(&source)) != NULL) {
+        if (verbose) fprintf(stderr, "%u %s %u W\n", record->timestamp, record->equipment_id, record->actual_delivered);
+        merged++;
+    }
+    merger.Flush();
+    fprintf(stderr, "%zu telegrams of %d meters merged\n", merged, files);
+
+    for (int i = 0; i < files; i++) {
+        free((void *)sources[i].Records);
+    }
+    delete[] sources;
+    return 0;
+}
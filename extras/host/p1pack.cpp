@@ -0,0 +1,115 @@
+/**
+ * @file p1pack.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Compresses an archive of raw telegrams with P1TemplateCodec, or restores it with -d
+ * @version 0.1
+ * @date 2022-05-21
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Usage: p1pack [-d] [-m meters] input output
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "P1Framing.h"
+#include "P1TemplateCodec.h"
+
+static size_t pack(P1TemplateCodec &codec, const char *input, size_t length, FILE *output) {
+    uint8_t record[BUFFER_SIZE + TEMPLATE_RECORD_MARGIN];
+    size_t position = 0, written = 0;
+
+    while (position < length) {
+        // A telegram up to the newline after the CRC, or the bytes up to the next telegram in pieces the codec accepts
+        size_t chunk = 0;
+        if (input[position] == '/') {
+            const char *last = P1TelegramEnd(input + position, input + length);
+            if (last != NULL) chunk = last + 1 - (input + position);
+        }
+        if (chunk == 0) {
+            const char *next = (const char *)memchr(input + position + 1, '/', length - position - 1);
+            chunk = (next != NULL ? next - input : length) - position;
+            if (chunk > BUFFER_SIZE - 1) chunk = BUFFER_SIZE - 1;
+        }
+
+        size_t recordLength = codec.Encode(input + position, chunk, record);
+        fwrite(record, 1, recordLength, output);
+        written += recordLength;
+        position += chunk;
+    }
+    return written;
+}
+
+static size_t unpack(P1TemplateCodec &codec, const uint8_t *input, size_t length, FILE *output) {
+    char telegram[BUFFER_SIZE];
+    size_t position = 0, written = 0;
+
+    while (position < length) {
+        size_t telegramLength;
+        size_t recordLength = codec.Decode(input + position, length - position, telegram, telegramLength);
+        if (recordLength == 0) {
+            fprintf(stderr, "Invalid record at %zu\n", position);
+            break;
+        }
+        fwrite(telegram, 1, telegramLength, output);
+        written += telegramLength;
+        position += recordLength;
+    }
+    return written;
+}
+
+int main(int argc, char **argv) {
+    bool decode = false;
+    uint16_t meters = 1024;
+
+    int option;
+    while ((option = getopt(argc, argv, "dm:")) != -1) {
+        switch (option) {
+        case 'd': decode = true; break;
+        case 'm': meters = strtoul(optarg, NULL, 10); break;
+        default: break;
+        }
+    }
+    if (argc - optind != 2) {
+        fprintf(stderr, "Usage: %s [-d] [-m meters] input output\n  -d  restore the telegrams\n  -m  meters with their own template, default 1024\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[optind], "rb");
+    if (file == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *input = (uint8_t *)malloc(length + 1);
+    if (input == NULL || fread(input, 1, length, file) != length) {
+        fprintf(stderr, "Could not read %s\n", argv[optind]);
+        return 1;
+    }
+    fclose(file);
+
+    FILE *output = fopen(argv[optind + 1], "wb");
+    if (output == NULL) {
+        perror(argv[optind + 1]);
+        return 1;
+    }
+
+    P1TemplateCodec codec(meters);
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t written = decode ? unpack(codec, input, length, output) : pack(codec, (const char *)input, length, output);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    fclose(output);
+
+    double seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%zu bytes to %zu bytes (%.1fx) in %.3f s: %.1f MB/s\n", length, written,
+            decode ? (double)written / length : (double)length / written, seconds, (decode ? written : length) / seconds / 1e6);
+
+    free(input);
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file p1parse.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief C interface of the host parser, see p1parse.h
+ * @version 0.1
+ * @date 2022-04-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Every thread parses with its own P1Meter, so the functions can be called from several threads at once
+ */
+
+#include "p1parse.h"
+#include "P1Deduplicator.h"
+#include "P1Framing.h"
+#include "P1MeterParser.h"
+
+static_assert(sizeof(p1_mbus_reading) == 16, "p1_mbus_reading layout changed");
+static_assert(sizeof(p1_record) == 224, "p1_record layout changed, update P1_ABI_VERSION");
+static_assert(P1_COLUMN_COUNT == Column_Count && P1_COLUMN_VOLTAGE == Column_VoltageL1 && P1_COLUMN_MBUS_VALUE == Column_MBusValue1,
+              "p1_columns does not match EP1Column, update P1_ABI_VERSION");
+static_assert(sizeof(p1_columns) == sizeof(P1ColumnBatch), "p1_columns does not match P1ColumnBatch");
+
+/***************** Helper functions *****************/
+
+static void fillRecord(p1_record *record, const P1Data &data) {
+    memset(record, 0, sizeof(p1_record));
+
+    record->timestamp = P1DateTimeToSeconds(data.DateTime);
+    record->crc = data.CRC;
+    record->flags = (data.ValidCRC ? P1_RECORD_VALID_CRC : 0) | (data.DateTime[12] == 'S' ? P1_RECORD_SUMMER_TIME : 0);
+    record->version = data.P1Version;
+    record->profile = data.Profile;
+    record->tariff = data.CurrentTariff;
+    record->mbus_count = data.NumberOfMBusDevices;
+    memcpy(record->equipment_id, data.EquipmentID, sizeof(record->equipment_id) - 1); // Zero terminated by the memset
+
+    record->delivered[0] = data.DeliveredTariff1;
+    record->delivered[1] = data.DeliveredTariff2;
+    record->produced[0] = data.ProducedTariff1;
+    record->produced[1] = data.ProducedTariff2;
+    record->actual_delivered = data.ActualDelivered;
+    record->actual_produced = data.ActualProduced;
+    record->power_failures = data.PowerFailures;
+    record->long_power_failures = data.LongPowerFailures;
+
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        record->voltage_sags[phase] = data.VoltageSags[phase];
+        record->voltage_swells[phase] = data.VoltageSwells[phase];
+        record->voltage[phase] = data.Voltage[phase];
+        record->current[phase] = data.Current[phase];
+        record->power_delivered[phase] = data.PowerDelivered[phase];
+        record->power_produced[phase] = data.PowerProduced[phase];
+    }
+
+    for (uint8_t i = 0; i < 3; i++) {
+        const MBusDevice &device = data.MBusDevices[i];
+        record->mbus[i].timestamp = P1DateTimeToSeconds(device.Reading.DateTime);
+        record->mbus[i].value = device.Reading.Value;
+        record->mbus[i].device_type = device.DeviceType;
+        P1UnitName(device.Reading.Unit, record->mbus[i].unit);
+    }
+}
+
+static size_t parseStream(p1_dedup *dedup, const uint8_t *buf, size_t len, p1_record *out, p1_columns *columns, size_t cap, size_t *consumed,
+                          size_t *duplicates);
+
+/***************** C interface *****************/
+
+struct p1_dedup {
+    P1Deduplicator deduplicator;
+
+    p1_dedup(uint32_t windowSeconds, uint32_t capacity) : deduplicator(windowSeconds, capacity) {}
+};
+
+uint32_t p1_abi_version(void) {
+    return P1_ABI_VERSION;
+}
+
+size_t p1_record_size(void) {
+    return sizeof(p1_record);
+}
+
+size_t p1_parse_many(const uint8_t *buf, size_t len, p1_record *out, size_t cap) {
+    return p1_parse_stream(buf, len, out, cap, NULL);
+}
+
+size_t p1_parse_stream(const uint8_t *buf, size_t len, p1_record *out, size_t cap, size_t *consumed) {
+    return parseStream(NULL, buf, len, out, NULL, cap, consumed, NULL);
+}
+
+p1_dedup *p1_dedup_create(uint32_t window_seconds, uint32_t capacity) {
+    return new p1_dedup(window_seconds, capacity);
+}
+
+void p1_dedup_destroy(p1_dedup *dedup) {
+    delete dedup;
+}
+
+size_t p1_parse_stream_unique(p1_dedup *dedup, const uint8_t *buf, size_t len, p1_record *out, size_t cap, size_t *consumed, size_t *duplicates) {
+    return parseStream(dedup, buf, len, out, NULL, cap, consumed, duplicates);
+}
+
+size_t p1_parse_columns(const uint8_t *buf, size_t len, p1_columns *columns, size_t cap, size_t *consumed) {
+    return parseStream(NULL, buf, len, NULL, columns, cap, consumed, NULL);
+}
+
+/***************** Helper functions *****************/
+
+static size_t parseStream(p1_dedup *dedup, const uint8_t *buf, size_t len, p1_record *out, p1_columns *columns, size_t cap, size_t *consumed,
+                          size_t *duplicates) {
+    static thread_local P1Meter meter(NULL);
+
+    const uint8_t *position = buf, *end = buf + len;
+    size_t count = 0;
+
+    while (count < cap && position < end) {
+        const uint8_t *start = (const uint8_t *)memchr(position, '/', end - position);
+        if (start == NULL) { // Only garbage left
+            position = end;
+            break;
+        }
+
+        const uint8_t *last = (const uint8_t *)P1TelegramEnd((const char *)start, (const char *)end);
+        if (last == NULL) {
+            if (end - start > BUFFER_SIZE - 1) { // Too long to be a telegram, look for the next start
+                position = start + 1;
+                continue;
+            }
+            position = start; // Incomplete, wait for more data
+            break;
+        }
+
+        size_t length = last - start + 1;
+        position = last + 1;
+        if (dedup != NULL && dedup->deduplicator.Duplicate((const char *)start, length)) {
+            if (duplicates != NULL) (*duplicates)++;
+            continue;
+        }
+
+        meter.LoadTelegram((const char *)start, length);
+        if (columns != NULL) {
+            meter.ProcessTelegram(*(P1ColumnBatch *)columns, count);
+            count++;
+            continue;
+        }
+
+        meter.ResetData(); // The telegrams may come from different meters and versions, a record only holds what its telegram sent
+        P1Data data = meter.ProcessTelegram();
+        fillRecord(&out[count], data);
+        out[count].offset = start - buf;
+        out[count].length = length;
+        count++;
+    }
+
+    if (consumed != NULL) *consumed = position - buf;
+    return count;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file p1parse.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief C interface of the host parser for use from other languages (Go cgo, Python ctypes or cffi, Rust)
+ * @version 0.1
+ * @date 2022-04-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The batch functions frame, CRC check and parse all telegrams in a buffer with one call, so the cost of crossing
+ * the language boundary is paid once per buffer instead of once per telegram. The records are plain structs with fixed size
+ * fields. Fields are only ever added at the end, with a new P1_ABI_VERSION. Check p1_abi_version and p1_record_size when loading the library.
+ * The one exception is version 2, which breaks version 1: the layout stayed the same but equipment_id holds the decoded identifier instead
+ * of the hex characters sent by the meter. Require version 2 or later when reading equipment_id
+ */
+
+#ifndef P1PARSE_H
+#define P1PARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define P1_ABI_VERSION 4 /* 2: equipment_id is decoded from hex (breaking), 3: p1_dedup functions, 4: p1_parse_columns */
+
+#define P1_RECORD_VALID_CRC     0x01 /* CRC matches, or a complete DSMR 2.2/3.0 telegram which has no CRC */
+#define P1_RECORD_SUMMER_TIME   0x02 /* The timestamp is in summer time (DST) */
+
+/**
+ * @brief Last reading of an M-Bus device (gas, water, thermal)
+ */
+typedef struct p1_mbus_reading {
+    uint32_t timestamp;     /* Seconds since 2000-01-01 local time, 0 when not sent */
+    uint32_t value;         /* In thousandths of the unit, e.g. dm3 for m3 */
+    uint8_t device_type;    /* 3 gas, 4 thermal, 7 water, 0 when not present */
+    char unit[4];           /* Zero terminated, e.g. "m3" */
+    uint8_t reserved[3];
+} p1_mbus_reading;
+
+/**
+ * @brief One parsed telegram
+ */
+typedef struct p1_record {
+    uint64_t offset;                /* Start of the telegram in the input buffer */
+    uint32_t length;                /* Length of the telegram in the input buffer */
+    uint32_t timestamp;             /* Seconds since 2000-01-01 local time, 0 when not sent */
+    uint16_t crc;                   /* As sent by the meter */
+    uint8_t flags;                  /* P1_RECORD_ flags */
+    uint8_t version;                /* DSMR version, e.g. 50 for 5.0. 0 for DSMR 2.2 and 3.0 */
+    uint8_t profile;                /* EP1Profile of the library */
+    uint8_t tariff;                 /* Tariff indicator */
+    uint8_t mbus_count;             /* Number of M-Bus devices */
+    uint8_t reserved;
+    char equipment_id[48];          /* Decoded from hex since version 2, hex as sent before. Zero terminated */
+    uint32_t delivered[2];          /* Energy delivered to the client per tariff in Wh */
+    uint32_t produced[2];           /* Energy delivered by the client per tariff in Wh */
+    uint32_t actual_delivered;      /* In W */
+    uint32_t actual_produced;       /* In W */
+    uint32_t power_failures;
+    uint32_t long_power_failures;
+    uint32_t voltage_sags[3];
+    uint32_t voltage_swells[3];
+    uint32_t voltage[3];            /* In 100 mV */
+    uint32_t current[3];            /* In A */
+    uint32_t power_delivered[3];    /* In W */
+    uint32_t power_produced[3];     /* In W */
+    p1_mbus_reading mbus[3];
+} p1_record;
+
+uint32_t p1_abi_version(void);
+size_t p1_record_size(void);
+
+/**
+ * @brief Parses all complete telegrams in buf into out
+ *
+ * @param buf Concatenated telegrams, anything in between is skipped
+ * @param len Number of bytes in buf
+ * @param out Records to fill
+ * @param cap Number of records in out
+ * @return size_t Number of records filled
+ */
+size_t p1_parse_many(const uint8_t *buf, size_t len, p1_record *out, size_t cap);
+
+/**
+ * @brief Same as p1_parse_many for data arriving in chunks. Keep the bytes from consumed onwards and pass them again with the next chunk
+ *
+ * @param consumed Set to the number of bytes handled. The rest is an incomplete telegram or did not fit in out
+ */
+size_t p1_parse_stream(const uint8_t *buf, size_t len, p1_record *out, size_t cap, size_t *consumed);
+
+/**
+ * @brief Set of the telegrams seen in the last time windows, to drop retransmitted telegrams before they are parsed
+ */
+typedef struct p1_dedup p1_dedup;
+
+/**
+ * @brief Creates a duplicate telegram set
+ *
+ * @param window_seconds Length of a time window, longer than the delay of a retransmission. The last two windows are kept
+ * @param capacity Number of telegrams per window, of any number of meters. Telegrams beyond it are passed on unchecked
+ */
+p1_dedup *p1_dedup_create(uint32_t window_seconds, uint32_t capacity);
+void p1_dedup_destroy(p1_dedup *dedup);
+
+/**
+ * @brief Same as p1_parse_stream, skipping telegrams of the same meter, timestamp and CRC as one seen before
+ *
+ * @param duplicates Incremented for every telegram skipped, may be NULL
+ */
+size_t p1_parse_stream_unique(p1_dedup *dedup, const uint8_t *buf, size_t len, p1_record *out, size_t cap, size_t *consumed, size_t *duplicates);
+
+/* Columns of p1_columns, the same as EP1Column. Values in the units of p1_record */
+#define P1_COLUMN_TIMESTAMP             0
+#define P1_COLUMN_DELIVERED_TARIFF1     1
+#define P1_COLUMN_DELIVERED_TARIFF2     2
+#define P1_COLUMN_PRODUCED_TARIFF1      3
+#define P1_COLUMN_PRODUCED_TARIFF2      4
+#define P1_COLUMN_TARIFF                5
+#define P1_COLUMN_ACTUAL_DELIVERED      6
+#define P1_COLUMN_ACTUAL_PRODUCED       7
+#define P1_COLUMN_POWER_FAILURES        8
+#define P1_COLUMN_LONG_POWER_FAILURES   9
+#define P1_COLUMN_VOLTAGE_SAGS          10 /* 3 columns, L1 to L3 */
+#define P1_COLUMN_VOLTAGE_SWELLS        13
+#define P1_COLUMN_VOLTAGE               16
+#define P1_COLUMN_CURRENT               19
+#define P1_COLUMN_POWER_DELIVERED       22
+#define P1_COLUMN_POWER_PRODUCED        25
+#define P1_COLUMN_AVERAGE_DEMAND        28 /* In W, Belgian meters */
+#define P1_COLUMN_VERSION               29
+#define P1_COLUMN_MBUS_VALUE            30 /* 3 columns, channel 1 to 3 */
+#define P1_COLUMN_COUNT                 33
+
+/**
+ * @brief Column arrays filled by p1_parse_columns, one row per telegram. Allocated by the caller
+ *
+ * Bitmaps hold row r in bit r % 8 of byte r / 8, so need (cap + 7) / 8 bytes
+ */
+typedef struct p1_columns {
+    uint32_t *columns[P1_COLUMN_COUNT]; /* cap values each, NULL for the columns not needed. 0 when not sent */
+    uint8_t *valid[P1_COLUMN_COUNT];    /* Bitmap of the rows with the value, may be NULL */
+    uint8_t *valid_crc;                 /* Bitmap of the rows with a valid CRC, may be NULL */
+} p1_columns;
+
+/**
+ * @brief Same as p1_parse_stream, parsing only the numeric values straight into column arrays, e.g. for analytics over archives.
+ * Faster than p1_parse_stream as no record is filled and the columns not needed are skipped
+ *
+ * @param cap Number of rows in the columns
+ */
+size_t p1_parse_columns(const uint8_t *buf, size_t len, p1_columns *columns, size_t cap, size_t *consumed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* P1PARSE_H */
@@ -0,0 +1,70 @@
+/**
+ * @file p1record.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Records the raw bytes and their timing from a P1 port to a file for p1replay
+ * @version 0.1
+ * @date 2022-03-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Usage: p1record -d device [-b baud] [-7] [-n telegrams] -o recording
+ */
+
+#include <getopt.h>
+#include <unistd.h>
+
+#include "FileStream.h"
+#include "P1MeterParser.h"
+#include "PosixSerial.h"
+
+int main(int argc, char **argv) {
+    const char *device = NULL, *path = NULL;
+    unsigned long baudRate = 115200, count = 0;
+    bool sevenBits = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "d:b:7n:o:")) != -1) {
+        switch (option) {
+        case 'd': device = optarg; break;
+        case 'b': baudRate = strtoul(optarg, NULL, 10); break;
+        case '7': sevenBits = true; break;
+        case 'n': count = strtoul(optarg, NULL, 10); break;
+        case 'o': path = optarg; break;
+        default: break;
+        }
+    }
+    if (device == NULL || path == NULL) {
+        fprintf(stderr, "Usage: %s -d device [-b baud] [-7] [-n telegrams] -o recording\n", argv[0]);
+        return 1;
+    }
+
+    int fd = PosixSerial::Open(device, baudRate, sevenBits);
+    FILE *file = fopen(path, "wb");
+    if (fd < 0 || file == NULL) {
+        perror(fd < 0 ? device : path);
+        return 1;
+    }
+
+    static PosixSerial serial(fd);
+    static P1Meter meter(&serial);
+    FileStream recording(file);
+    meter.SetRecorder(&recording);
+
+    // Stop between telegrams so the recording never ends halfway a telegram
+    for (unsigned long received = 0; count == 0 || received < count;) {
+        meter.ReceiveTelegram();
+        if (meter.DataReady) {
+            P1Data data = meter.ProcessTelegram();
+            received++;
+            fprintf(stderr, "Telegram %lu %.13s CRC %s\n", received, data.DateTime, data.ValidCRC ? "valid" : "invalid");
+            fflush(file);
+        } else if (serial.EndOfFile) {
+            break;
+        } else if (!serial.available()) {
+            usleep(100);
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file p1replay.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Feeds a recording through ReceiveTelegram and ProcessTelegram at the original timing or as fast as possible
+ * @version 0.1
+ * @date 2022-03-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Usage: p1replay [-f] [-v] recording
+ */
+
+#include <getopt.h>
+
+#include "FileStream.h"
+#include "P1MeterParser.h"
+#include "P1Replayer.h"
+
+int main(int argc, char **argv) {
+    bool fast = false, verbose = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "fv")) != -1) {
+        switch (option) {
+        case 'f': fast = true; break;
+        case 'v': verbose = true; break;
+        default: break;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-f] [-v] recording\n  -f  replay as fast as possible\n  -v  print every telegram\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[optind], "rb");
+    if (file == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    FileStream recording(file);
+    static P1Replayer replayer(&recording, !fast);
+    static P1Meter meter(&replayer);
+    unsigned long received = 0, validCRC = 0, incomplete = 0, parseSum = 0, parseMax = 0;
+    unsigned long start = micros();
+
+    while (!replayer.Finished()) {
+        meter.ReceiveTelegram();
+        if (meter.Incomplete) { // Cut off by a stall longer than RECEIVE_TIMEOUT or by the end of the recording
+            incomplete++;
+            printf("Incomplete telegram of %d bytes%s:\n%s\n", meter.GetBufferLength() + 1, replayer.Finished() ? " at the end of the recording" : "",
+                   meter.GetBuffer());
+            memset(meter.GetBuffer(), 0, BUFFER_SIZE);
+            meter.Incomplete = false;
+        }
+        if (!meter.DataReady) continue;
+
+        unsigned long parseStart = micros();
+        P1Data data = meter.ProcessTelegram();
+        unsigned long parse = micros() - parseStart;
+
+        received++;
+        validCRC += data.ValidCRC;
+        parseSum += parse;
+        if (parse > parseMax) parseMax = parse;
+        if (verbose) {
+            printf("%lu %.13s CRC %s, %u W, parsed in %lu us\n", received, data.DateTime, data.ValidCRC ? "valid" : "invalid", data.ActualDelivered, parse);
+        }
+    }
+
+    unsigned long elapsed = micros() - start;
+    printf("Telegrams:   %lu (%lu valid CRC, %lu incomplete) in %.3f s\n", received, validCRC, incomplete, elapsed / 1e6);
+    printf("Parse time:  %.1f us average, %lu us max\n", received ? (double)parseSum / received : 0.0, parseMax);
+    fclose(file);
+    return validCRC == received && incomplete == 0 ? 0 : 2;
+}
@@ -0,0 +1,229 @@
+/**
+ * @file p1sim.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Simulates a P1 port on a pseudo terminal and benchmarks the receive, frame and parse path of the library against it
+ * @version 0.1
+ * @date 2022-03-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The meter sends a telegram every interval (1 s for DSMR 5, 10 s before) while the request line is high and paces the bytes at the baud rate.
+ * -x speeds both up by a factor, -x 0 sends as fast as the pseudo terminal accepts.
+ * Without -p the library runs in the same process on the other end of the pseudo terminal and its request (CTS) pin is followed through ArduinoPinHook.
+ * With -p the pseudo terminal is left for another program and the request line is considered always high
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "P1MeterParser.h"
+#include "P1TelegramGenerator.h"
+#include "PosixSerial.h"
+
+#define REQUEST_PIN 5
+#define CHUNK_SIZE  64 // Bytes written at once, like a meter filling the UART FIFO
+
+static std::atomic<bool> requested(false);
+static std::atomic<bool> running(true);
+static std::atomic<bool> meterStopped(false); // Set by the meter thread when it has sent the count or failed to write
+static std::atomic<bool> writeFailed(false);
+static std::atomic<unsigned long> telegramEnd(0); // micros() when the last byte of the latest telegram was written
+static unsigned long requestToggles = 0;
+
+static void requestHook(uint8_t pin, uint8_t function, uint8_t value) {
+    if (pin != REQUEST_PIN) return;
+
+    bool high;
+    if (function == 1) high = (value == HIGH); // digitalWrite
+    else if (value == INPUT) high = false; // pinMode INPUT releases the line (high impedance)
+    else return; // pinMode OUTPUT alone doesn't change the level
+
+    if (high != requested.load()) requestToggles++;
+    requested = high;
+}
+
+static void sleepUntil(unsigned long due) {
+    long wait = (long)(due - micros());
+    if (wait > 0) usleep(wait);
+}
+
+/**
+ * @brief Telegrams from the generator or looped from a recorded file with concatenated telegrams
+ *
+ */
+class TelegramSource {
+public:
+    TelegramSource(const P1GeneratorConfig &config, const char *path) : generator(config) {
+        if (path == NULL) return;
+
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) {
+            perror(path);
+            exit(1);
+        }
+        int c;
+        while ((c = fgetc(file)) != EOF) recording.push_back(c);
+        fclose(file);
+
+        for (size_t i = 0; i < recording.size(); i++) {
+            if (recording[i] == '/' && (i == 0 || recording[i - 1] == '\n')) starts.push_back(i);
+        }
+        if (starts.empty()) {
+            fprintf(stderr, "No telegrams in %s\n", path);
+            exit(1);
+        }
+        starts.push_back(recording.size());
+    }
+
+    uint16_t Next(char *output, uint16_t size) {
+        if (starts.empty()) return generator.Next(output, size);
+
+        size_t start = starts[index], length = starts[index + 1] - start;
+        index = (index + 1) % (starts.size() - 1);
+        if (length > size) length = size;
+        memcpy(output, &recording[start], length);
+        return length;
+    }
+
+private:
+    P1TelegramGenerator generator;
+    std::vector<char> recording;
+    std::vector<size_t> starts;
+    size_t index = 0;
+};
+
+static void simulateMeter(int fd, TelegramSource &source, unsigned long count, double intervalMicros, double byteMicros, bool alwaysRequested) {
+    char telegram[4096];
+    unsigned long nextTelegram = micros();
+
+    for (unsigned long sent = 0; (count == 0 || sent < count) && running; sent++) {
+        while (!alwaysRequested && !requested && running) usleep(50);
+        if (intervalMicros > 0) {
+            sleepUntil(nextTelegram);
+            nextTelegram += (unsigned long)intervalMicros;
+            if ((long)(micros() - nextTelegram) > 0) nextTelegram = micros(); // Don't catch up after a stall
+        }
+
+        uint16_t length = source.Next(telegram, sizeof(telegram));
+        unsigned long byteStart = micros();
+        for (uint16_t offset = 0; offset < length; offset += CHUNK_SIZE) {
+            uint16_t chunk = min(length - offset, CHUNK_SIZE);
+            if (byteMicros > 0) sleepUntil(byteStart + (unsigned long)(offset * byteMicros));
+            if (offset + chunk >= length) telegramEnd = micros();
+
+            const char *data = telegram + offset;
+            while (chunk > 0) {
+                ssize_t written = write(fd, data, chunk);
+                if (written < 0) {
+                    if (errno == EAGAIN || errno == EINTR) {
+                        usleep(10);
+                        continue;
+                    }
+                    perror("write");
+                    writeFailed = true;
+                    meterStopped = true;
+                    return;
+                }
+                data += written;
+                chunk -= written;
+            }
+        }
+    }
+    meterStopped = true;
+}
+
+int main(int argc, char **argv) {
+    P1GeneratorConfig config;
+    const char *recording = NULL;
+    unsigned long count = 10, baudRate = 0;
+    double factor = 1;
+    bool standalone = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "v:1m:f:b:x:n:p")) != -1) {
+        switch (option) {
+        case 'v': config.Version = atoi(optarg); break;
+        case '1': config.NumberOfPhases = 1; break;
+        case 'm': config.NumberOfMBusDevices = atoi(optarg); break;
+        case 'f': recording = optarg; break;
+        case 'b': baudRate = strtoul(optarg, NULL, 10); break;
+        case 'x': factor = atof(optarg); break;
+        case 'n': count = strtoul(optarg, NULL, 10); break;
+        case 'p': standalone = true; break;
+        default:
+            fprintf(stderr, "Usage: %s [-v version] [-1] [-m mbus devices] [-f recording] [-b baud] [-x speed factor] [-n count, 0 is endless] [-p]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (baudRate == 0) baudRate = config.Version < 40 ? 9600 : 115200;
+
+    // Both ends in raw mode so the line endings and the CRC pass unchanged
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pseudo terminal");
+        return 1;
+    }
+    int slave = PosixSerial::Open(ptsname(master), baudRate, config.Version < 40);
+    struct termios settings;
+    tcgetattr(master, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(master, TCSANOW, &settings);
+
+    double intervalMicros = factor > 0 ? (config.Version >= 50 ? 1e6 : 10e6) / factor : 0;
+    double byteMicros = factor > 0 ? 10e6 / baudRate / factor : 0; // Start, 8 data (or 7 + parity) and stop bit
+    TelegramSource source(config, recording);
+
+    if (standalone) {
+        fprintf(stderr, "Meter available on %s\n", ptsname(master));
+        simulateMeter(master, source, count, intervalMicros, byteMicros, true);
+        return 0;
+    }
+
+    ArduinoPinHook = requestHook;
+    std::thread meterThread(simulateMeter, master, std::ref(source), count, intervalMicros, byteMicros, false);
+
+    static PosixSerial serial(slave);
+    static P1Meter meter(&serial, REQUEST_PIN);
+    unsigned long received = 0, validCRC = 0, bytes = 0;
+    unsigned long latencySum = 0, latencyMax = 0, parseSum = 0, parseMax = 0;
+    unsigned long start = micros();
+
+    while (count == 0 || received < count) {
+        meter.ReceiveTelegram();
+        if (!meter.DataReady) {
+            // Nothing more will come once the meter stopped and its bytes are read, e.g. after a write error or a lost telegram
+            if (meterStopped && serial.available() == 0) break;
+            continue;
+        }
+
+        unsigned long ready = micros();
+        unsigned long latency = (long)(ready - telegramEnd.load()) > 0 ? ready - telegramEnd.load() : 0;
+        bytes += meter.GetBufferLength() + 1;
+        P1Data data = meter.ProcessTelegram();
+        unsigned long parse = micros() - ready;
+
+        received++;
+        validCRC += data.ValidCRC;
+        latencySum += latency;
+        parseSum += parse;
+        if (latency > latencyMax) latencyMax = latency;
+        if (parse > parseMax) parseMax = parse;
+    }
+    unsigned long elapsed = micros() - start;
+    running = false;
+    meterThread.join();
+
+    printf("Telegrams:        %lu (%lu valid CRC)\n", received, validCRC);
+    printf("Throughput:       %.1f telegrams/s, %.1f kB/s\n", received * 1e6 / elapsed, bytes * 1e3 / elapsed);
+    printf("Receive latency:  %.1f us average, %lu us max (last byte written to DataReady)\n", received ? (double)latencySum / received : 0.0, latencyMax);
+    printf("Parse time:       %.1f us average, %lu us max\n", received ? (double)parseSum / received : 0.0, parseMax);
+    printf("Request toggles:  %lu\n", requestToggles);
+    if (writeFailed) return 1;
+    return validCRC == received ? 0 : 2;
+}
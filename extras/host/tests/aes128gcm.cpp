@@ -0,0 +1,106 @@
+/**
+ * @file aes128gcm.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Known answer test of AES128GCM with the test cases of the GCM specification
+ * @version 0.1
+ * @date 2022-06-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Run by make check, once with the hardware path of the host and once built with AES128GCM_PORTABLE
+ */
+
+#include <stdio.h>
+
+#include "AES128GCM.h"
+
+struct TestCase {
+    const char *key;
+    const char *iv;
+    const char *aad;
+    const char *plaintext;
+    const char *ciphertext;
+    const char *tag;
+};
+
+// Test cases 1 to 4 of The Galois/Counter Mode of Operation (GCM), McGrew and Viega
+static const TestCase testCases[] = {
+    { "00000000000000000000000000000000", "000000000000000000000000", "", "", "", "58e2fccefa7e3061367f1d57a4e7455a" },
+    { "00000000000000000000000000000000", "000000000000000000000000", "", "00000000000000000000000000000000",
+      "0388dace60b6a392f328c2b971b2fe78", "ab6e47d42cec13bdf53a67b21257bddf" },
+    { "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "",
+      "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255",
+      "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985",
+      "4d5c2af327cd64a62cf35abd2ba6fab4" },
+    { "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+      "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+      "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+      "5bc94fbc3221a5db94fae95ae7121a47" },
+};
+
+static uint16_t fromHex(const char *hex, uint8_t *output) {
+    uint16_t length = strlen(hex) / 2;
+    for (uint16_t i = 0; i < length; i++) {
+        unsigned value;
+        sscanf(hex + 2 * i, "%2x", &value);
+        output[i] = value;
+    }
+    return length;
+}
+
+int main() {
+    AES128GCM gcm;
+    uint8_t key[16], iv[12], aad[20], plaintext[64], data[64], tag[16];
+    int failures = 0;
+
+    for (uint8_t i = 0; i < sizeof(testCases) / sizeof(testCases[0]); i++) {
+        const TestCase &test = testCases[i];
+        fromHex(test.key, key);
+        fromHex(test.iv, iv);
+        uint16_t aadLength = fromHex(test.aad, aad);
+        fromHex(test.plaintext, plaintext);
+        fromHex(test.tag, tag);
+        gcm.SetKey(key);
+
+        // The full tag, and the 12 bytes DLMS meters send
+        for (uint8_t tagLength = 16; tagLength >= 12; tagLength -= 4) {
+            uint16_t length = fromHex(test.ciphertext, data);
+            if (!gcm.Decrypt(iv, aad, aadLength, data, length, tag, tagLength) || memcmp(data, plaintext, length) != 0) {
+                printf("Test case %u with a %u byte tag failed\n", i + 1, tagLength);
+                failures++;
+            }
+        }
+
+        // A changed tag, ciphertext or additional data is rejected
+        uint16_t length = fromHex(test.ciphertext, data);
+        tag[0] ^= 0x01;
+        if (gcm.Decrypt(iv, aad, aadLength, data, length, tag, 16)) {
+            printf("Test case %u accepted a changed tag\n", i + 1);
+            failures++;
+        }
+        tag[0] ^= 0x01;
+        if (length > 0) {
+            length = fromHex(test.ciphertext, data);
+            data[length - 1] ^= 0x80;
+            if (gcm.Decrypt(iv, aad, aadLength, data, length, tag, 16)) {
+                printf("Test case %u accepted a changed ciphertext\n", i + 1);
+                failures++;
+            }
+        }
+        if (aadLength > 0) {
+            length = fromHex(test.ciphertext, data);
+            aad[0] ^= 0x01;
+            if (gcm.Decrypt(iv, aad, aadLength, data, length, tag, 16)) {
+                printf("Test case %u accepted changed additional data\n", i + 1);
+                failures++;
+            }
+        }
+    }
+
+#if defined(AES128GCM_USE_AESNI)
+    printf("AES-128-GCM (AES-NI): %d failures\n", failures);
+#else
+    printf("AES-128-GCM (portable): %d failures\n", failures);
+#endif
+    return failures == 0 ? 0 : 1;
+}
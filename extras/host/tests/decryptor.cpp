@@ -0,0 +1,91 @@
+/**
+ * @file decryptor.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Checks that P1Decryptor only accepts encrypted and authenticated frames once an authentication key is set
+ * @version 0.1
+ * @date 2022-06-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Run by make check. The frames carry test case 3 of the GCM specification, its IV is the system title and frame counter
+ */
+
+#include <stdio.h>
+
+#include "P1Decryptor.h"
+
+#define TEST_TEXT_SIZE 64
+
+static const char *key = "feffe9928665731c6d6a8f9467308308";
+static const char *iv = "cafebabefacedbaddecaf888";
+static const char *plaintext = "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255";
+static const char *ciphertext = "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985";
+
+struct TestCase {
+    const char *name;
+    bool authenticationKey;
+    uint8_t securityControl;
+    bool accepted;
+};
+
+static const TestCase testCases[] = {
+    { "Encrypted frame without a key", false, DLMS_SECURITY_ENCRYPTED, true },
+    { "Encrypted frame without a tag", true, DLMS_SECURITY_ENCRYPTED, false },
+    { "Authenticated frame that isn't encrypted", true, DLMS_SECURITY_AUTHENTICATED, false },
+    { "Plain frame", true, 0, false },
+    { "Encrypted and authenticated frame with a wrong tag", true, DLMS_SECURITY_ENCRYPTED | DLMS_SECURITY_AUTHENTICATED, false },
+};
+
+static uint16_t fromHex(const char *hex, uint8_t *output) {
+    uint16_t length = strlen(hex) / 2;
+    for (uint16_t i = 0; i < length; i++) {
+        unsigned value;
+        sscanf(hex + 2 * i, "%2x", &value);
+        output[i] = value;
+    }
+    return length;
+}
+
+static uint16_t buildFrame(uint8_t securityControl, uint8_t *frame) {
+    uint8_t payload = 1 + DLMS_FRAME_COUNTER_SIZE + TEST_TEXT_SIZE + ((securityControl & DLMS_SECURITY_AUTHENTICATED) ? DLMS_TAG_SIZE : 0);
+    uint16_t length = 0;
+    frame[length++] = DLMS_GENERAL_GLO_CIPHERING;
+    frame[length++] = DLMS_SYSTEM_TITLE_SIZE;
+    length += fromHex(iv, frame + length) - DLMS_FRAME_COUNTER_SIZE; // The system title, the frame counter follows the length
+    frame[length++] = 0x81;
+    frame[length++] = payload;
+    frame[length++] = securityControl;
+    fromHex(iv + 2 * DLMS_SYSTEM_TITLE_SIZE, frame + length);
+    length += DLMS_FRAME_COUNTER_SIZE;
+    length += fromHex(ciphertext, frame + length);
+    if (securityControl & DLMS_SECURITY_AUTHENTICATED) {
+        memset(frame + length, 0xA5, DLMS_TAG_SIZE);
+        length += DLMS_TAG_SIZE;
+    }
+    return length;
+}
+
+int main() {
+    uint8_t encryptionKey[AES128_KEY_SIZE], authenticationKey[AES128_KEY_SIZE], expected[TEST_TEXT_SIZE], frame[128];
+    int failures = 0;
+
+    fromHex(key, encryptionKey);
+    memset(authenticationKey, 0x5A, sizeof(authenticationKey));
+    fromHex(plaintext, expected);
+
+    for (uint8_t i = 0; i < sizeof(testCases) / sizeof(testCases[0]); i++) {
+        const TestCase &test = testCases[i];
+        P1Decryptor decryptor(encryptionKey, test.authenticationKey ? authenticationKey : NULL);
+        uint16_t length = buildFrame(test.securityControl, frame);
+        int16_t plainLength = decryptor.Decrypt(frame, length);
+
+        bool accepted = plainLength == TEST_TEXT_SIZE && memcmp(frame, expected, TEST_TEXT_SIZE) == 0;
+        if (accepted != test.accepted || (!test.accepted && plainLength != -1)) {
+            printf("%s: %s\n", test.name, plainLength < 0 ? "rejected" : "accepted");
+            failures++;
+        }
+    }
+
+    printf("Decryptor security levels: %d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
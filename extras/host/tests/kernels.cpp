@@ -0,0 +1,128 @@
+/**
+ * @file kernels.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Compares the column kernels with plain loops on random columns, bitmaps and row ranges
+ * @version 0.1
+ * @date 2022-06-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Run by make check, once with the vector loops of the host and once built with P1_COLUMN_SCALAR. Both print every result,
+ * so make check also compares the two outputs
+ */
+
+#include <stdio.h>
+
+#include "P1ColumnKernels.h"
+
+#define TEST_ROUNDS     3000
+#define TEST_MAX_ROWS   300
+#define TEST_MAX_BINS   300
+#define TEST_MAX_BUCKETS 40
+
+static uint32_t state = 2022;
+
+static uint32_t random32() { // xorshift32, the same sequence on every platform
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static bool valid(const uint8_t *bitmap, size_t row) {
+    return bitmap == NULL || (bitmap[row / 8] >> (row % 8) & 1);
+}
+
+static uint32_t delta(const uint32_t *values, const uint8_t *bitmap, size_t row) {
+    if (row == 0 || !valid(bitmap, row) || !valid(bitmap, row - 1)) return 0;
+    return values[row] >= values[row - 1] ? values[row] - values[row - 1] : values[row];
+}
+
+static void add(P1ColumnStats &stats, uint32_t value) {
+    stats.Sum += value;
+    if (value < stats.Min) stats.Min = value;
+    if (value > stats.Max) stats.Max = value;
+    stats.Count++;
+}
+
+static bool same(const P1ColumnStats &a, const P1ColumnStats &b) {
+    return a.Sum == b.Sum && a.Min == b.Min && a.Max == b.Max && a.Count == b.Count;
+}
+
+int main() {
+    uint32_t values[TEST_MAX_ROWS], timestamps[TEST_MAX_ROWS], deltas[TEST_MAX_ROWS];
+    uint8_t bitmap[(TEST_MAX_ROWS + 7) / 8];
+    int failures = 0;
+
+    for (int round = 0; round < TEST_ROUNDS; round++) {
+        // Random values, small values, values around the wrap of 32 bits and a rising register with resets
+        size_t rows = 1 + random32() % TEST_MAX_ROWS;
+        uint8_t kind = random32() % 4;
+        uint32_t timestamp = 1000 + random32() % 50;
+        for (size_t row = 0; row < rows; row++) {
+            values[row] = kind == 0 ? random32() : kind == 1 ? random32() % 3000 : kind == 2 ? 0xFFFFFFF0 + random32() % 16
+                                                                                         : row * 7 + random32() % 5;
+            if (kind == 3 && random32() % 50 == 0) values[row] = random32() % 100;
+            timestamps[row] = timestamp;
+            timestamp += random32() % 4;
+        }
+        for (size_t i = 0; i < (rows + 7) / 8; i++) {
+            uint8_t kindOfByte = random32() % 8;
+            bitmap[i] = kindOfByte < 3 ? 0xFF : kindOfByte == 3 ? 0 : random32();
+        }
+        const uint8_t *validBitmap = random32() % 4 == 0 ? NULL : bitmap;
+        size_t begin = random32() % rows, end = begin + random32() % (rows - begin + 1);
+
+        P1ColumnStats stats = P1ColumnAggregate(values, validBitmap, begin, end), expectedStats;
+        for (size_t row = begin; row < end; row++) {
+            if (valid(validBitmap, row)) add(expectedStats, values[row]);
+        }
+        if (!same(stats, expectedStats)) failures++;
+        printf("%d aggregate %llu %u %u %u\n", round, (unsigned long long)stats.Sum, stats.Min, stats.Max, stats.Count);
+
+        memset(deltas, 0, sizeof(deltas));
+        uint64_t total = P1ColumnDeltas(values, validBitmap, begin, end, deltas), expectedTotal = 0;
+        for (size_t row = begin; row < end; row++) {
+            expectedTotal += delta(values, validBitmap, row);
+            if (deltas[row] != delta(values, validBitmap, row)) failures++;
+        }
+        if (total != expectedTotal) failures++;
+        printf("%d deltas %llu\n", round, (unsigned long long)total);
+
+        uint32_t low = random32() % 2000, width = 1 + random32() % 40;
+        uint16_t binCount = 1 + random32() % TEST_MAX_BINS;
+        uint32_t bins[TEST_MAX_BINS] = {}, expectedBins[TEST_MAX_BINS] = {};
+        P1ColumnHistogram(values, validBitmap, begin, end, low, width, bins, binCount);
+        for (size_t row = begin; row < end; row++) {
+            if (!valid(validBitmap, row)) continue;
+            uint32_t bin = values[row] > low ? (values[row] - low) / width : 0;
+            expectedBins[bin < binCount ? bin : binCount - 1]++;
+        }
+        if (memcmp(bins, expectedBins, sizeof(bins)) != 0) failures++;
+        printf("%d histogram", round);
+        for (uint16_t bin = 0; bin < binCount; bin++) printf(" %u", bins[bin]);
+        printf("\n");
+
+        uint32_t bucketSeconds = 1 + random32() % 10, start = timestamps[0] + random32() % 10;
+        size_t bucketCount = 1 + random32() % TEST_MAX_BUCKETS;
+        P1ColumnStats buckets[TEST_MAX_BUCKETS], expectedBuckets[TEST_MAX_BUCKETS];
+        uint64_t deltaBuckets[TEST_MAX_BUCKETS] = {}, expectedDeltaBuckets[TEST_MAX_BUCKETS] = {};
+        P1ColumnAggregateBuckets(timestamps, values, validBitmap, rows, start, bucketSeconds, buckets, bucketCount);
+        P1ColumnDeltaBuckets(timestamps, values, validBitmap, rows, start, bucketSeconds, deltaBuckets, bucketCount);
+        for (size_t row = 0; row < rows; row++) {
+            if (timestamps[row] < start || (timestamps[row] - start) / bucketSeconds >= bucketCount) continue;
+            size_t bucket = (timestamps[row] - start) / bucketSeconds;
+            if (valid(validBitmap, row)) add(expectedBuckets[bucket], values[row]);
+            expectedDeltaBuckets[bucket] += delta(values, validBitmap, row);
+        }
+        printf("%d buckets", round);
+        for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+            if (!same(buckets[bucket], expectedBuckets[bucket]) || deltaBuckets[bucket] != expectedDeltaBuckets[bucket]) failures++;
+            printf(" %llu/%u/%llu", (unsigned long long)buckets[bucket].Sum, buckets[bucket].Count, (unsigned long long)deltaBuckets[bucket]);
+        }
+        printf("\n");
+    }
+
+    fprintf(stderr, "Column kernels (%s): %d failures\n", P1ColumnKernelName(), failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file voltage_quality.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Checks the EN 50160 judgement of P1VoltageQuality at the limits
+ * @version 0.1
+ * @date 2022-06-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Run by make check. Every window gets a single telegram, so its mean is the voltage of that telegram
+ */
+
+#include <stdio.h>
+
+#include "P1VoltageQuality.h"
+
+struct TestCase {
+    uint16_t voltage; // In 100 mV
+    bool below; // Below -15 % of 230 V
+    bool within; // Within 10 % of 230 V
+    bool above; // Above +10 % of 230 V
+};
+
+static const TestCase testCases[] = {
+    { 1950, true, false, false },
+    { 1954, true, false, false },
+    { 1955, false, false, false }, // Exactly -15 %
+    { 2065, false, false, false },
+    { 2069, false, false, false },
+    { 2070, false, true, false }, // Exactly -10 %
+    { 2300, false, true, false },
+    { 2530, false, true, false }, // Exactly +10 %
+    { 2531, false, false, true },
+    { 2534, false, false, true },
+    { 2535, false, false, true },
+    { 2600, false, false, true },
+};
+
+int main() {
+    int failures = 0;
+    uint32_t start = P1DateTimeToSeconds("220601000000S");
+
+    for (uint8_t i = 0; i < sizeof(testCases) / sizeof(testCases[0]); i++) {
+        const TestCase &test = testCases[i];
+        P1VoltageQuality quality(2300);
+        P1Data data = P1Data();
+        data.Voltage[0] = test.voltage;
+        P1SecondsToDateTime(start, data.DateTime, true);
+        quality.Update(data);
+        quality.Flush();
+
+        P1VoltageCompliance compliance = P1VoltageQuality::Evaluate(quality.Summary);
+        bool within = compliance.WithinPermille[0] == 1000;
+        if (compliance.Windows[0] != 1 || (compliance.Below[0] == 1) != test.below || within != test.within || (compliance.Above[0] == 1) != test.above) {
+            printf("A mean of %u.%u V: %u below, %u permille within, %u above\n", test.voltage / 10, test.voltage % 10, compliance.Below[0],
+                   compliance.WithinPermille[0], compliance.Above[0]);
+            failures++;
+        }
+    }
+
+    printf("Voltage quality limits: %d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
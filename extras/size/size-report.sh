@@ -0,0 +1,58 @@
+#!/bin/sh
+# Reports the flash used by the library: the bytes of every library function and constant table linked into the sketch, and
+# the totals of the sketch.
+# Usage: size-report.sh <build path of arduino-cli compile --build-path> <toolchain prefix, e.g. avr- or arm-none-eabi->
+#
+# The tools are searched in the Arduino data folder when they are not on the PATH
+
+BUILD_PATH="$1"
+PREFIX="$2"
+ARDUINO_DATA="${ARDUINO_DATA:-$HOME/.arduino15}"
+
+if [ -z "$BUILD_PATH" ] || [ ! -d "$BUILD_PATH" ]; then
+    echo "Usage: $0 <build path> <toolchain prefix>" >&2
+    exit 1
+fi
+
+findTool() {
+    if command -v "${PREFIX}$1" > /dev/null 2>&1; then
+        command -v "${PREFIX}$1"
+    else
+        find "$ARDUINO_DATA/packages" -type f -path "*/bin/${PREFIX}$1" 2> /dev/null | head -n 1
+    fi
+}
+
+NM=$(findTool nm)
+SIZE=$(findTool size)
+if [ -z "$NM" ] || [ -z "$SIZE" ]; then
+    echo "No ${PREFIX}nm or ${PREFIX}size found" >&2
+    exit 1
+fi
+
+OBJECTS=$(find "$BUILD_PATH/libraries" -path "*P1MeterParser*" -name "*.o" | sort)
+ELF=$(find "$BUILD_PATH" -maxdepth 1 -name "*.elf" | head -n 1)
+
+if [ -z "$ELF" ]; then
+    echo "No .elf found in $BUILD_PATH" >&2
+    exit 1
+fi
+
+# The names of the functions (t, T, w and W) and constant tables (r and R, PROGMEM on AVR) the library defines
+LIBRARY_SYMBOLS=$(mktemp)
+trap 'rm -f "$LIBRARY_SYMBOLS"' EXIT
+"$NM" --defined-only --demangle $OBJECTS 2> /dev/null |
+    awk '$2 ~ /^[tTwWrR]$/ { name = $3; for (i = 4; i <= NF; i++) name = name " " $i; print name }' | sort -u > "$LIBRARY_SYMBOLS"
+
+echo "| Symbol | Flash bytes |"
+echo "|---|---:|"
+# Sizes from the linked sketch, largest first, so symbols which are not linked in aren't counted
+"$NM" --size-sort --demangle --radix=d "$ELF" 2> /dev/null | sort -rn |
+    awk 'NR == FNR { library[$0] = 1; next }
+         $2 ~ /^[tTwWrR]$/ { name = $3; for (i = 4; i <= NF; i++) name = name " " $i
+                             if (name in library) { total += $1; printf "| `%s` | %d |\n", name, $1 } }
+         END { printf "| **Library total** | **%d** |\n", total }' "$LIBRARY_SYMBOLS" -
+
+echo
+echo '```'
+"$SIZE" "$ELF"
+echo '```'
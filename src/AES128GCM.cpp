@@ -0,0 +1,305 @@
+/**
+ * @file AES128GCM.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief AES-128 GCM decryption for encrypted P1 telegrams
+ * @version 0.1
+ * @date 2022-01-15
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note See NIST SP 800-38D for the GCM specification
+ */
+
+#include "AES128GCM.h"
+
+static const uint8_t sbox[256] PROGMEM = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+#define SBOX(x) pgm_read_byte(&sbox[(x)])
+#define XTIME(x) ((uint8_t)(((x) << 1) ^ (((x) & 0x80) ? 0x1b : 0x00)))
+
+/**
+ * @brief Sets the 16 byte key and precomputes the round keys and the GHASH key
+ *
+ * @param key The 16 byte AES key (the GUEK for DLMS meters)
+ */
+void AES128GCM::SetKey(const uint8_t *key) {
+    uint8_t rcon = 0x01;
+
+    memcpy(roundKeys, key, AES128_KEY_SIZE);
+    for (uint8_t i = AES128_KEY_SIZE; i < AES128_ROUND_KEYS; i += 4) {
+        uint8_t temp[4] = { roundKeys[i - 4], roundKeys[i - 3], roundKeys[i - 2], roundKeys[i - 1] };
+
+        if (i % AES128_KEY_SIZE == 0) { // RotWord, SubWord and Rcon
+            uint8_t first = temp[0];
+            temp[0] = SBOX(temp[1]) ^ rcon;
+            temp[1] = SBOX(temp[2]);
+            temp[2] = SBOX(temp[3]);
+            temp[3] = SBOX(first);
+            rcon = XTIME(rcon);
+        }
+
+        for (uint8_t j = 0; j < 4; j++) {
+            roundKeys[i + j] = roundKeys[i + j - AES128_KEY_SIZE] ^ temp[j];
+        }
+    }
+
+    // H = E(K, 0^128)
+    uint8_t h[AES128_BLOCK_SIZE];
+    memset(h, 0, AES128_BLOCK_SIZE);
+    EncryptBlock(h, h);
+
+#if defined(AES128GCM_USE_AESNI)
+    const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    hashKey = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)h), reverse);
+#else
+    uint64_t vh = 0, vl = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        vh = (vh << 8) | h[i];
+        vl = (vl << 8) | h[i + 8];
+    }
+
+    hashTableLow[0] = 0;
+    hashTableHigh[0] = 0;
+    hashTableLow[8] = vl;
+    hashTableHigh[8] = vh;
+
+    for (uint8_t i = 4; i > 0; i >>= 1) {
+        uint32_t t = (vl & 1) * 0xe1000000UL;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ ((uint64_t)t << 32);
+        hashTableLow[i] = vl;
+        hashTableHigh[i] = vh;
+    }
+
+    for (uint8_t i = 2; i <= 8; i *= 2) {
+        for (uint8_t j = 1; j < i; j++) {
+            hashTableHigh[i + j] = hashTableHigh[i] ^ hashTableHigh[j];
+            hashTableLow[i + j] = hashTableLow[i] ^ hashTableLow[j];
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Encrypts a single 16 byte block. Input and output may point to the same buffer
+ *
+ * @param input The plain block
+ * @param output The encrypted block
+ */
+void AES128GCM::EncryptBlock(const uint8_t *input, uint8_t *output) {
+#if defined(AES128GCM_USE_AESNI)
+    __m128i state = _mm_xor_si128(_mm_loadu_si128((const __m128i *)input), _mm_loadu_si128((const __m128i *)roundKeys));
+    for (uint8_t round = 1; round < 10; round++) {
+        state = _mm_aesenc_si128(state, _mm_loadu_si128((const __m128i *)&roundKeys[round * AES128_BLOCK_SIZE]));
+    }
+    state = _mm_aesenclast_si128(state, _mm_loadu_si128((const __m128i *)&roundKeys[10 * AES128_BLOCK_SIZE]));
+    _mm_storeu_si128((__m128i *)output, state);
+#else
+    uint8_t state[AES128_BLOCK_SIZE];
+    for (uint8_t i = 0; i < AES128_BLOCK_SIZE; i++) {
+        state[i] = input[i] ^ roundKeys[i];
+    }
+
+    for (uint8_t round = 1; round <= 10; round++) {
+        // SubBytes and ShiftRows combined. State is column major, byte i is row i % 4 of column i / 4
+        uint8_t shifted[AES128_BLOCK_SIZE];
+        for (uint8_t i = 0; i < AES128_BLOCK_SIZE; i++) {
+            shifted[i] = SBOX(state[(i + 4 * (i % 4)) % AES128_BLOCK_SIZE]);
+        }
+
+        const uint8_t *roundKey = &roundKeys[round * AES128_BLOCK_SIZE];
+        if (round == 10) { // No MixColumns in the last round
+            for (uint8_t i = 0; i < AES128_BLOCK_SIZE; i++) {
+                state[i] = shifted[i] ^ roundKey[i];
+            }
+            break;
+        }
+
+        for (uint8_t c = 0; c < AES128_BLOCK_SIZE; c += 4) {
+            uint8_t a0 = shifted[c], a1 = shifted[c + 1], a2 = shifted[c + 2], a3 = shifted[c + 3];
+            uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+            state[c] = a0 ^ all ^ XTIME(a0 ^ a1) ^ roundKey[c];
+            state[c + 1] = a1 ^ all ^ XTIME(a1 ^ a2) ^ roundKey[c + 1];
+            state[c + 2] = a2 ^ all ^ XTIME(a2 ^ a3) ^ roundKey[c + 2];
+            state[c + 3] = a3 ^ all ^ XTIME(a3 ^ a0) ^ roundKey[c + 3];
+        }
+    }
+
+    memcpy(output, state, AES128_BLOCK_SIZE);
+#endif
+}
+
+/**
+ * @brief Verifies and decrypts the data in place
+ *
+ * @param iv The 12 byte initialisation vector. For DLMS this is the system title followed by the frame counter
+ * @param aad The additional authenticated data, can be NULL when aadLength is 0
+ * @param aadLength Length of the additional authenticated data
+ * @param data The cipher text, replaced with the plain text
+ * @param length Length of the cipher text
+ * @param tag The received authentication tag. Pass NULL to skip authentication
+ * @param tagLength Length of the received tag, DLMS uses 12 bytes
+ * @return true When the tag matched or no tag was given
+ * @return false When the tag did not match. The data is decrypted anyway
+ */
+bool AES128GCM::Decrypt(const uint8_t *iv, const uint8_t *aad, uint16_t aadLength, uint8_t *data, uint16_t length, const uint8_t *tag, uint8_t tagLength) {
+    uint8_t counter[AES128_BLOCK_SIZE];
+    uint8_t keyStream[AES128_BLOCK_SIZE];
+    uint8_t hash[AES128_BLOCK_SIZE];
+    memset(hash, 0, AES128_BLOCK_SIZE);
+
+    // J0 = IV || 0^31 || 1
+    memcpy(counter, iv, GCM_IV_SIZE);
+    counter[12] = 0;
+    counter[13] = 0;
+    counter[14] = 0;
+    counter[15] = 1;
+
+    for (uint16_t i = 0; i < aadLength; i += AES128_BLOCK_SIZE) {
+        ghashBlock(hash, aad + i, min(aadLength - i, AES128_BLOCK_SIZE));
+    }
+
+    for (uint16_t i = 0; i < length; i += AES128_BLOCK_SIZE) {
+        uint8_t blockLength = min(length - i, AES128_BLOCK_SIZE);
+        ghashBlock(hash, data + i, blockLength); // Hash the cipher text before it gets overwritten
+
+        for (uint8_t j = 15; j >= 12; j--) { // inc32
+            if (++counter[j] != 0) break;
+        }
+        EncryptBlock(counter, keyStream);
+        for (uint8_t j = 0; j < blockLength; j++) {
+            data[i + j] ^= keyStream[j];
+        }
+    }
+
+    if (tag == NULL) return true;
+
+    // Length block with the bit lengths of the aad and the cipher text
+    uint8_t lengths[AES128_BLOCK_SIZE];
+    memset(lengths, 0, AES128_BLOCK_SIZE);
+    uint32_t aadBits = (uint32_t)aadLength * 8, dataBits = (uint32_t)length * 8;
+    for (uint8_t j = 0; j < 4; j++) {
+        lengths[7 - j] = aadBits >> (8 * j);
+        lengths[15 - j] = dataBits >> (8 * j);
+    }
+    ghashBlock(hash, lengths, AES128_BLOCK_SIZE);
+
+    // Tag = E(K, J0) ^ GHASH
+    counter[12] = 0;
+    counter[13] = 0;
+    counter[14] = 0;
+    counter[15] = 1;
+    EncryptBlock(counter, keyStream);
+
+    uint8_t difference = 0;
+    for (uint8_t j = 0; j < tagLength && j < AES128_BLOCK_SIZE; j++) {
+        difference |= (keyStream[j] ^ hash[j]) ^ tag[j];
+    }
+    return difference == 0;
+}
+
+
+/***************** Helper functions *****************/
+
+void AES128GCM::ghashBlock(uint8_t *y, const uint8_t *block, uint8_t blockLength) {
+    for (uint8_t i = 0; i < blockLength; i++) {
+        y[i] ^= block[i]; // Partial blocks are zero padded
+    }
+    gfMultiply(y);
+}
+
+#if defined(AES128GCM_USE_AESNI)
+
+void AES128GCM::gfMultiply(uint8_t *x) {
+    // Carry-less multiplication and reduction, see the Intel Carry-Less Multiplication white paper (algorithm 5)
+    const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)x), reverse);
+    __m128i b = hashKey;
+
+    __m128i low = _mm_clmulepi64_si128(a, b, 0x00);
+    __m128i middle = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+    __m128i high = _mm_clmulepi64_si128(a, b, 0x11);
+    low = _mm_xor_si128(low, _mm_slli_si128(middle, 8));
+    high = _mm_xor_si128(high, _mm_srli_si128(middle, 8));
+
+    // Shift the 256 bit product left by one because of the reflected bit order
+    __m128i lowCarry = _mm_srli_epi32(low, 31);
+    __m128i highCarry = _mm_srli_epi32(high, 31);
+    low = _mm_slli_epi32(low, 1);
+    high = _mm_slli_epi32(high, 1);
+    __m128i crossCarry = _mm_srli_si128(lowCarry, 12);
+    highCarry = _mm_slli_si128(highCarry, 4);
+    lowCarry = _mm_slli_si128(lowCarry, 4);
+    low = _mm_or_si128(low, lowCarry);
+    high = _mm_or_si128(high, highCarry);
+    high = _mm_or_si128(high, crossCarry);
+
+    // Reduce modulo x^128 + x^7 + x^2 + x + 1
+    __m128i t = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(low, 31), _mm_slli_epi32(low, 30)), _mm_slli_epi32(low, 25));
+    __m128i tHigh = _mm_srli_si128(t, 4);
+    low = _mm_xor_si128(low, _mm_slli_si128(t, 12));
+    __m128i r = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(low, 1), _mm_srli_epi32(low, 2)), _mm_srli_epi32(low, 7));
+    r = _mm_xor_si128(r, tHigh);
+    low = _mm_xor_si128(low, r);
+    high = _mm_xor_si128(high, low);
+
+    _mm_storeu_si128((__m128i *)x, _mm_shuffle_epi8(high, reverse));
+}
+
+#else
+
+static const uint16_t last4[16] PROGMEM = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+void AES128GCM::gfMultiply(uint8_t *x) {
+    // Shoup's 4-bit table method
+    uint8_t nibble = x[15] & 0x0f;
+    uint64_t zh = hashTableHigh[nibble];
+    uint64_t zl = hashTableLow[nibble];
+
+    for (int8_t i = 15; i >= 0; i--) {
+        uint8_t low = x[i] & 0x0f;
+        uint8_t high = x[i] >> 4;
+        uint8_t remainder;
+
+        if (i != 15) {
+            remainder = zl & 0x0f;
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ ((uint64_t)pgm_read_word(&last4[remainder]) << 48);
+            zh ^= hashTableHigh[low];
+            zl ^= hashTableLow[low];
+        }
+
+        remainder = zl & 0x0f;
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ ((uint64_t)pgm_read_word(&last4[remainder]) << 48);
+        zh ^= hashTableHigh[high];
+        zl ^= hashTableLow[high];
+    }
+
+    for (uint8_t i = 0; i < 8; i++) {
+        x[7 - i] = zh >> (8 * i);
+        x[15 - i] = zl >> (8 * i);
+    }
+}
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file AES128GCM.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief AES-128 GCM decryption for encrypted P1 telegrams
+ * @version 0.1
+ * @date 2022-01-15
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The software path uses a byte oriented S-box AES and a 4-bit table GHASH (256 bytes per key).
+ * When compiled for a host with AES-NI and PCLMULQDQ enabled (-maes -mpclmul or -march=native) the hardware instructions are used instead.
+ * Define AES128GCM_PORTABLE to always use the software path
+ */
+
+#ifndef AES128GCM_H
+#define AES128GCM_H
+
+#include <Arduino.h>
+
+#if !defined(AES128GCM_PORTABLE) && defined(__AES__) && defined(__PCLMUL__) && defined(__SSSE3__) && (defined(__x86_64__) || defined(__i386__))
+#define AES128GCM_USE_AESNI
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+#define AES128_KEY_SIZE     16
+#define AES128_BLOCK_SIZE   16
+#define AES128_ROUND_KEYS   176 // 11 round keys of 16 bytes
+#define GCM_IV_SIZE         12
+
+/**
+ * @brief AES-128 in Galois/Counter mode. Only the parts needed to verify and decrypt a DLMS frame are implemented
+ *
+ */
+class AES128GCM {
+public:
+    void SetKey(const uint8_t *key);
+    bool Decrypt(const uint8_t *iv, const uint8_t *aad, uint16_t aadLength, uint8_t *data, uint16_t length, const uint8_t *tag, uint8_t tagLength);
+    void EncryptBlock(const uint8_t *input, uint8_t *output);
+
+private:
+    void ghashBlock(uint8_t *y, const uint8_t *block, uint8_t blockLength);
+    void gfMultiply(uint8_t *x);
+
+    uint8_t roundKeys[AES128_ROUND_KEYS];
+
+#if defined(AES128GCM_USE_AESNI)
+    __m128i hashKey; // Byte reflected H
+#else
+    uint64_t hashTableLow[16]; // Multiples of H for the 4-bit GHASH
+    uint64_t hashTableHigh[16];
+#endif
+};
+
+#endif // AES128GCM_H
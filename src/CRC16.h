@@ -16,25 +16,24 @@
 
 #define POLYNOMIAL_IBM_REVERSED 0xA001 // See https://en.wikipedia.org/wiki/Cyclic_redundancy_check on the Reversed CRC-16-IBM
 
-/***************** CRC16 calulation *****************/
-uint16_t CRC16_IBM_REVERSED(char *buf, uint16_t len)
-{
-    uint16_t crc = 0x00;
+#if defined(__x86_64__) || (defined(__aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define CRC16_SLICE_BY_8 // 8 bytes per step with 8 tables of 512 bytes, for the host tools
+#endif
 
-    for (uint16_t pos = 0; pos < len; pos++) {
-        crc ^= (uint16_t)buf[pos];    // XOR byte into least sig. byte of crc
+#if defined(__AVR__)
+extern const uint16_t CRC16_IBM_REVERSED_NIBBLES[16] PROGMEM; // CRC of each nibble value
+#else
+extern const uint16_t CRC16_IBM_REVERSED_BYTES[256] PROGMEM; // CRC of each byte value
+#endif
 
-        for (int16_t i = 8; i != 0; i--) {    // Loop over each bit
-            if ((crc & 0x0001) != 0) {      // If the LSB is set
-                crc >>= 1;                    // Shift right and XOR 0xA001 
-                crc ^= POLYNOMIAL_IBM_REVERSED;
-            } else {                        // Else LSB is not set
-                crc >>= 1;                    // Just shift right
-            }
-        }
-    }
-
-    return crc;
-}
+/**
+ * @brief Calculates the CRC of the buffer
+ * 
+ * @param buf The data
+ * @param len Length of the data
+ * @param crc CRC of the preceding data when calculating the CRC in parts
+ * @return uint16_t The CRC
+ */
+uint16_t CRC16_IBM_REVERSED(const char *buf, uint16_t len, uint16_t crc = 0x00);
 
-#endif // CRC16_H
\ No newline at end of file
+#endif // CRC16_H
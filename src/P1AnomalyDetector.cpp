@@ -0,0 +1,128 @@
+/**
+ * @file P1AnomalyDetector.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Streaming detection of phase loss, over/under voltage, unusual values and stuck meters
+ * @version 0.1
+ * @date 2022-02-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1AnomalyDetector.h"
+
+#define STATISTICS_WARMUP   32 // Samples before deviations are reported
+#define MAX_DEVIATION       46340 // Largest deviation of which the square fits an int32_t
+
+/**
+ * @brief Construct a new anomaly detector with the default thresholds
+ *
+ * @param callback The function called for every anomaly
+ */
+P1AnomalyDetector::P1AnomalyDetector(P1AnomalyCallback callback) {
+    this->callback = callback;
+}
+
+/**
+ * @brief Construct a new anomaly detector
+ *
+ * @param callback The function called for every anomaly
+ * @param thresholds The limits to check against
+ */
+P1AnomalyDetector::P1AnomalyDetector(P1AnomalyCallback callback, const P1AnomalyThresholds &thresholds) {
+    this->callback = callback;
+    this->thresholds = thresholds;
+}
+
+/**
+ * @brief Checks a new telegram
+ *
+ * @param data The parsed telegram
+ */
+void P1AnomalyDetector::Update(const P1Data &data) {
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        int32_t phaseVoltage = data.Voltage[phase];
+
+        if (phaseVoltage >= (int32_t)thresholds.PhaseLossVoltage) {
+            phasePresent |= 1 << phase;
+        }
+        if ((phasePresent & (1 << phase)) == 0) continue; // Single phase meters report 0 for L2 and L3
+
+        checkThreshold(phaseVoltage < (int32_t)thresholds.PhaseLossVoltage, 0, PhaseLoss, phase, phaseVoltage);
+        checkThreshold(thresholds.OverVoltage != 0 && phaseVoltage > (int32_t)thresholds.OverVoltage, 3, OverVoltage, phase, phaseVoltage);
+        checkThreshold(thresholds.UnderVoltage != 0 && phaseVoltage < (int32_t)thresholds.UnderVoltage && phaseVoltage >= (int32_t)thresholds.PhaseLossVoltage, 6, UnderVoltage, phase, phaseVoltage);
+        checkThreshold(thresholds.MaxCurrent != 0 && data.Current[phase] > thresholds.MaxCurrent, 9, OverCurrent, phase, data.Current[phase]);
+
+        // Minimum deviations of 2 V, 2 A and 200 W keep steady signals from reporting every small step
+        checkDeviation(voltage[phase], phaseVoltage, 20, VoltageDeviation, phase);
+        checkDeviation(current[phase], data.Current[phase], 2, CurrentDeviation, phase);
+        checkDeviation(power[phase], (int32_t)data.PowerDelivered[phase] - (int32_t)data.PowerProduced[phase], 200, PowerDeviation, phase);
+
+        if (started && data.VoltageSags[phase] > sags[phase]) {
+            callback(VoltageSag, phase, data.VoltageSags[phase] - sags[phase]);
+        }
+        if (started && data.VoltageSwells[phase] > swells[phase]) {
+            callback(VoltageSwell, phase, data.VoltageSwells[phase] - swells[phase]);
+        }
+        sags[phase] = data.VoltageSags[phase];
+        swells[phase] = data.VoltageSwells[phase];
+    }
+
+    // Stuck meter. Compare the energy the actual power should have registered with the register movement
+    uint32_t energy = data.DeliveredTariff1 + data.DeliveredTariff2 + data.ProducedTariff1 + data.ProducedTariff2;
+    uint32_t seconds = P1DateTimeToSeconds(data.DateTime);
+    if (started && energy == lastEnergy && seconds > lastSeconds) {
+        // W times s / 3.6 gives mWh
+        expectedEnergy += (uint32_t)((uint64_t)(data.ActualDelivered + data.ActualProduced) * (seconds - lastSeconds) * 10 / 36);
+    } else {
+        expectedEnergy = 0;
+    }
+    checkThreshold(thresholds.StuckEnergy != 0 && expectedEnergy > thresholds.StuckEnergy * 1000, 12, StuckMeter, 0, expectedEnergy / 1000);
+
+    lastEnergy = energy;
+    lastSeconds = seconds;
+    started = true;
+}
+
+
+/***************** Helper functions *****************/
+
+void P1AnomalyDetector::checkDeviation(movingStatistics &statistics, int32_t value, int32_t minimumDeviation, EP1Anomaly anomaly, uint8_t phase) {
+    if (statistics.samples == 0) {
+        statistics.mean = value * 16;
+    }
+
+    int32_t deviation = value - (statistics.mean >> 4);
+    if (deviation > MAX_DEVIATION) deviation = MAX_DEVIATION;
+    if (deviation < -MAX_DEVIATION) deviation = -MAX_DEVIATION;
+    int32_t squared = deviation * deviation;
+
+    if (statistics.samples >= STATISTICS_WARMUP) {
+        int32_t limit = max(statistics.variance, minimumDeviation * minimumDeviation);
+        uint8_t sigma = thresholds.DeviationSigma;
+        bool deviating = sigma != 0 && (int64_t)squared > (int64_t)limit * sigma * sigma;
+        if (deviating && !statistics.deviating) {
+            callback(anomaly, phase, value);
+        }
+        statistics.deviating = deviating;
+    } else {
+        statistics.samples++;
+    }
+
+    statistics.mean += (value * 16 - statistics.mean) / 16;
+    statistics.variance += (squared - statistics.variance) >> 4;
+}
+
+void P1AnomalyDetector::checkThreshold(bool condition, uint16_t flag, EP1Anomaly anomaly, uint8_t phase, int32_t value) {
+    uint16_t mask = 1 << (flag + phase);
+
+    if (condition && (activeFlags & mask) == 0) {
+        callback(anomaly, phase, value);
+    }
+
+    if (condition) {
+        activeFlags |= mask;
+    } else {
+        activeFlags &= ~mask;
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * @file P1AnomalyDetector.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Streaming detection of phase loss, over/under voltage, unusual values and stuck meters
+ * @version 0.1
+ * @date 2022-02-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Every signal keeps an exponentially weighted moving average and variance (alpha = 1/16) in integers.
+ * Threshold events are only reported on the transition into the anomalous state, not on every telegram
+ */
+
+#ifndef P1ANOMALYDETECTOR_H
+#define P1ANOMALYDETECTOR_H
+
+#include <Arduino.h>
+#include "P1MeterParser.h"
+
+enum EP1Anomaly {
+    PhaseLoss,          // Voltage of a phase dropped below the phase loss threshold
+    OverVoltage,        // Voltage above the upper limit, e.g. caused by a PV inverter
+    UnderVoltage,       // Voltage below the lower limit
+    OverCurrent,        // Current above the fuse size
+    VoltageDeviation,   // Voltage far outside its moving average
+    CurrentDeviation,   // Current far outside its moving average
+    PowerDeviation,     // Net power of a phase far outside its moving average
+    VoltageSag,         // The meter counted new voltage sags
+    VoltageSwell,       // The meter counted new voltage swells
+    StuckMeter          // Power is reported but the energy registers don't move
+};
+
+/**
+ * @brief Limits for the detector. Voltages are in 100 mV like P1Data, 0 disables a check
+ *
+ */
+struct P1AnomalyThresholds {
+    uint32_t PhaseLossVoltage = 1000;   // 100 V
+    uint32_t OverVoltage = 2530;        // 253 V, +10% of the nominal 230 V
+    uint32_t UnderVoltage = 2070;       // 207 V, -10% of the nominal 230 V
+    uint32_t MaxCurrent = 0;            // In A
+    uint8_t DeviationSigma = 4;         // Report values more than this number of standard deviations from the average
+    uint32_t StuckEnergy = 20;          // Wh that should have been registered based on the actual power before a stuck meter is reported
+};
+
+/**
+ * @brief Called for every detected anomaly
+ *
+ * @param anomaly The kind of anomaly
+ * @param phase The phase index (0 for L1) or 0 for anomalies not tied to a phase
+ * @param value The value that triggered the event, e.g. the voltage or the number of new sags
+ */
+typedef void (*P1AnomalyCallback)(EP1Anomaly anomaly, uint8_t phase, int32_t value);
+
+/**
+ * @brief Checks every telegram against fixed thresholds and the statistics of the previous telegrams
+ *
+ */
+class P1AnomalyDetector {
+public:
+    P1AnomalyDetector(P1AnomalyCallback callback);
+    P1AnomalyDetector(P1AnomalyCallback callback, const P1AnomalyThresholds &thresholds);
+
+    void Update(const P1Data &data);
+
+private:
+    struct movingStatistics {
+        int32_t mean; // Moving average with 4 fractional bits
+        int32_t variance; // Moving variance in units squared
+        uint8_t samples;
+        bool deviating;
+    };
+
+    void checkDeviation(movingStatistics &statistics, int32_t value, int32_t minimumDeviation, EP1Anomaly anomaly, uint8_t phase);
+    void checkThreshold(bool condition, uint16_t flag, EP1Anomaly anomaly, uint8_t phase, int32_t value);
+
+    P1AnomalyCallback callback;
+    P1AnomalyThresholds thresholds;
+
+    movingStatistics voltage[3] = {};
+    movingStatistics current[3] = {};
+    movingStatistics power[3] = {};
+
+    uint16_t activeFlags = 0; // Bit per threshold anomaly and phase that is currently active
+    uint16_t phasePresent = 0; // Bit per phase that has had a voltage above the phase loss threshold
+
+    uint32_t sags[3] = {};
+    uint32_t swells[3] = {};
+
+    uint32_t lastEnergy = 0;
+    uint32_t lastSeconds = 0;
+    uint32_t expectedEnergy = 0; // mWh expected from the actual power since the registers last changed
+    bool started = false;
+};
+
+#endif // P1ANOMALYDETECTOR_H
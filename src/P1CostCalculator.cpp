@@ -0,0 +1,98 @@
+/**
+ * @file P1CostCalculator.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Running energy cost per tariff register with optional hourly dynamic prices
+ * @version 0.1
+ * @date 2022-02-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1CostCalculator.h"
+#include "P1Register.h"
+
+/**
+ * @brief Construct a new cost calculator with fixed prices per tariff
+ *
+ * @param deliveredTariff1 Price of energy delivered to the client in tariff 1 (low) in millionths per kWh
+ * @param deliveredTariff2 Price of energy delivered to the client in tariff 2 (high) in millionths per kWh
+ * @param producedTariff1 Compensation for energy delivered by the client in tariff 1 in millionths per kWh
+ * @param producedTariff2 Compensation for energy delivered by the client in tariff 2 in millionths per kWh
+ */
+P1CostCalculator::P1CostCalculator(int32_t deliveredTariff1, int32_t deliveredTariff2, int32_t producedTariff1, int32_t producedTariff2) {
+    deliveredPrices[0] = deliveredTariff1;
+    deliveredPrices[1] = deliveredTariff2;
+    producedPrices[0] = producedTariff1;
+    producedPrices[1] = producedTariff2;
+}
+
+/**
+ * @brief Sets a table of hourly prices which replaces the tariff prices for the hours it covers. The table is not copied
+ *
+ * @param start Start of the first hour in seconds since 2000-01-01, see P1DateTimeToSeconds
+ * @param prices Price per hour in millionths per kWh, used for both delivered and produced energy
+ * @param numberOfHours Number of prices in the table
+ */
+void P1CostCalculator::SetDynamicPrices(uint32_t start, const int32_t *prices, uint16_t numberOfHours) {
+    dynamicStart = start;
+    dynamicPrices = prices;
+    dynamicHours = numberOfHours;
+}
+
+/**
+ * @brief Adds the cost of the energy registered since the previous telegram
+ *
+ * @param data The parsed telegram
+ */
+void P1CostCalculator::Update(const P1Data &data) {
+    uint32_t seconds = P1DateTimeToSeconds(data.DateTime);
+    CurrentPrice = priceAt(seconds, deliveredPrices[data.CurrentTariff == 1 ? 0 : 1]);
+
+    if (started) {
+        uint32_t delivered1 = P1RegisterDelta(data.DeliveredTariff1, registers[0]);
+        uint32_t delivered2 = P1RegisterDelta(data.DeliveredTariff2, registers[1]);
+        uint32_t produced1 = P1RegisterDelta(data.ProducedTariff1, registers[2]);
+        uint32_t produced2 = P1RegisterDelta(data.ProducedTariff2, registers[3]);
+
+        // Wh times millionths per kWh gives billionths
+        DeliveredCost[0] += (int64_t)delivered1 * priceAt(seconds, deliveredPrices[0]);
+        DeliveredCost[1] += (int64_t)delivered2 * priceAt(seconds, deliveredPrices[1]);
+        ProducedCredit[0] += (int64_t)produced1 * priceAt(seconds, producedPrices[0]);
+        ProducedCredit[1] += (int64_t)produced2 * priceAt(seconds, producedPrices[1]);
+    }
+
+    registers[0] = data.DeliveredTariff1;
+    registers[1] = data.DeliveredTariff2;
+    registers[2] = data.ProducedTariff1;
+    registers[3] = data.ProducedTariff2;
+    started = true;
+}
+
+/**
+ * @brief Clears the totals, e.g. at the start of a billing period. The register readings are kept so no energy is lost
+ *
+ */
+void P1CostCalculator::Reset() {
+    DeliveredCost[0] = DeliveredCost[1] = 0;
+    ProducedCredit[0] = ProducedCredit[1] = 0;
+}
+
+/**
+ * @brief Gets the net cost
+ *
+ * @return int64_t The delivered cost minus the produced compensation in billionths, @see P1_NANO_PER_CENT
+ */
+int64_t P1CostCalculator::TotalCost() const {
+    return DeliveredCost[0] + DeliveredCost[1] - ProducedCredit[0] - ProducedCredit[1];
+}
+
+
+/***************** Helper functions *****************/
+
+int32_t P1CostCalculator::priceAt(uint32_t seconds, int32_t tariffPrice) const {
+    if (dynamicPrices == NULL || seconds < dynamicStart) return tariffPrice;
+
+    uint32_t hour = (seconds - dynamicStart) / 3600;
+    return hour < dynamicHours ? dynamicPrices[hour] : tariffPrice;
+}
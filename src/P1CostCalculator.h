@@ -0,0 +1,54 @@
+/**
+ * @file P1CostCalculator.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Running energy cost per tariff register with optional hourly dynamic prices
+ * @version 0.1
+ * @date 2022-02-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Prices are fixed point in millionths of the currency per kWh (0.28134 EUR/kWh is 281340).
+ * As the registers are in Wh the costs are in billionths of the currency, which is exact and fits a year of a large building in an int64_t
+ */
+
+#ifndef P1COSTCALCULATOR_H
+#define P1COSTCALCULATOR_H
+
+#include <Arduino.h>
+#include "P1MeterParser.h"
+
+#define P1_NANO_PER_CENT 10000000LL // Divide a cost by this to get cents
+
+/**
+ * @brief Integrates the cost of the delivered and produced energy from successive telegrams
+ *
+ */
+class P1CostCalculator {
+public:
+    P1CostCalculator(int32_t deliveredTariff1, int32_t deliveredTariff2, int32_t producedTariff1, int32_t producedTariff2);
+
+    void SetDynamicPrices(uint32_t start, const int32_t *prices, uint16_t numberOfHours);
+    void Update(const P1Data &data);
+    void Reset();
+
+    int64_t TotalCost() const;
+
+    int64_t DeliveredCost[2] = {}; // Cost of the delivered energy per tariff register in billionths
+    int64_t ProducedCredit[2] = {}; // Compensation for the produced energy per tariff register in billionths
+    int32_t CurrentPrice = 0; // Price of the delivered energy right now in millionths per kWh
+
+private:
+    int32_t priceAt(uint32_t seconds, int32_t tariffPrice) const;
+
+    int32_t deliveredPrices[2];
+    int32_t producedPrices[2];
+
+    const int32_t *dynamicPrices = NULL; // Hourly prices, owned by the caller
+    uint32_t dynamicStart = 0; // Start of the first hour in seconds since 2000-01-01
+    uint16_t dynamicHours = 0;
+
+    uint32_t registers[4]; // Delivered tariff 1 and 2, produced tariff 1 and 2 of the previous telegram
+    bool started = false;
+};
+
+#endif // P1COSTCALCULATOR_H
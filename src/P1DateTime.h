@@ -0,0 +1,106 @@
+/**
+ * @file P1DateTime.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Conversion of the P1 date-time stamps and fixed point values to compact integers
+ * @version 0.1
+ * @date 2022-01-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef P1DATETIME_H
+#define P1DATETIME_H
+
+#include <Arduino.h>
+
+#define P1_DATETIME_LENGTH 13 // YYMMDDhhmmssX
+
+/**
+ * @brief Converts a P1 date-time stamp (YYMMDDhhmmssX) to the number of seconds since 2000-01-01 00:00:00 local time
+ * @note The summer/winter time flag is ignored so the result is local time as displayed by the meter
+ *
+ * @param dateTime The date-time stamp, at least 12 digits
+ * @return uint32_t Seconds since 2000-01-01 or 0 when the stamp is not valid
+ */
+inline uint32_t P1DateTimeToSeconds(const char *dateTime) {
+    uint8_t fields[6];
+    for (uint8_t i = 0; i < 6; i++) {
+        uint8_t tens = dateTime[2 * i] - '0', units = dateTime[2 * i + 1] - '0';
+        if (tens > 9 || units > 9) return 0;
+        fields[i] = tens * 10 + units;
+    }
+    if (fields[1] < 1 || fields[1] > 12 || fields[2] < 1) return 0;
+
+    // Days since 2000-01-01, counting march as the first month so the leap day is at the end of the year
+    uint16_t year = 2000 + fields[0] - (fields[1] <= 2);
+    uint8_t month = fields[1] <= 2 ? fields[1] + 9 : fields[1] - 3;
+    uint32_t days = 365UL * year + year / 4 - year / 100 + year / 400 + (153U * month + 2) / 5 + fields[2] - 1;
+    days -= 730425UL; // Same calculation for 2000-01-01
+
+    return ((days * 24 + fields[3]) * 60 + fields[4]) * 60 + fields[5];
+}
+
+/**
+ * @brief Converts a number of seconds since 2000-01-01 back to a P1 date-time stamp
+ *
+ * @param seconds Seconds since 2000-01-01 00:00:00 local time
+ * @param dateTime Output for the 13 characters YYMMDDhhmmssX, not 0 terminated
+ * @param summerTime True for the S (summer) flag, false for W (winter)
+ */
+inline void P1SecondsToDateTime(uint32_t seconds, char *dateTime, bool summerTime) {
+    uint32_t days = seconds / 86400UL + 730425UL; // Days since 0000-03-01
+    uint32_t secondOfDay = seconds % 86400UL;
+
+    // Inverse of the calculation in P1DateTimeToSeconds
+    uint32_t era = days / 146097UL, dayOfEra = days % 146097UL;
+    uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    uint8_t month = (5 * dayOfYear + 2) / 153;
+    uint8_t fields[6];
+    fields[2] = dayOfYear - (153 * month + 2) / 5 + 1;
+    fields[1] = month < 10 ? month + 3 : month - 9;
+    fields[0] = (era * 400 + yearOfEra + (fields[1] <= 2)) % 100;
+    fields[3] = secondOfDay / 3600;
+    fields[4] = (secondOfDay / 60) % 60;
+    fields[5] = secondOfDay % 60;
+
+    for (uint8_t i = 0; i < 6; i++) {
+        dateTime[2 * i] = '0' + fields[i] / 10;
+        dateTime[2 * i + 1] = '0' + fields[i] % 10;
+    }
+    dateTime[12] = summerTime ? 'S' : 'W';
+}
+
+/**
+ * @brief Parses a fixed point value like 000123.456 into an integer with the given number of decimals.
+ * Parsing stops at the first character that isn't a digit or the decimal point, so the unit is ignored
+ *
+ * @param value Pointer to the first digit of the value
+ * @param decimals The number of decimals of the result. 3 turns 0.352 kW into 352 W
+ * @return uint32_t The scaled value
+ */
+inline uint32_t P1ParseFixedPoint(const char *value, uint8_t decimals) {
+    uint32_t result = 0;
+    int8_t fraction = -1; // Number of digits after the decimal point, -1 before the point
+
+    for (;; value++) {
+        uint8_t digit = *value - '0';
+        if (digit <= 9) {
+            if (fraction >= decimals) continue; // Drop the excess precision
+            result = result * 10 + digit;
+            if (fraction >= 0) fraction++;
+        } else if (*value == '.' && fraction < 0) {
+            fraction = 0;
+        } else {
+            break;
+        }
+    }
+
+    for (int8_t i = fraction < 0 ? 0 : fraction; i < decimals; i++) {
+        result *= 10;
+    }
+    return result;
+}
+
+#endif // P1DATETIME_H
@@ -0,0 +1,113 @@
+/**
+ * @file P1Decryptor.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Unwraps and decrypts DLMS general-glo-ciphering frames as sent by the Luxembourg (Smarty) and Austrian smart meters
+ * @version 0.1
+ * @date 2022-01-15
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1Decryptor.h"
+
+/**
+ * @brief Construct a new decryptor
+ *
+ * @param encryptionKey The 16 byte encryption key (GUEK) as provided by the grid operator
+ * @param authenticationKey The 16 byte authentication key (GAK). Pass NULL to skip the tag verification, with a key only
+ * encrypted and authenticated frames are accepted
+ */
+P1Decryptor::P1Decryptor(const uint8_t *encryptionKey, const uint8_t *authenticationKey) {
+    cipher.SetKey(encryptionKey);
+
+    if (authenticationKey != NULL) {
+        memcpy(this->authenticationKey, authenticationKey, AES128_KEY_SIZE);
+        hasAuthenticationKey = true;
+    } else {
+        memset(this->authenticationKey, 0, AES128_KEY_SIZE); // Still part of the additional data
+    }
+    memset(SystemTitle, 0, DLMS_SYSTEM_TITLE_SIZE);
+}
+
+/**
+ * @brief Determines the total frame length from the start of a frame
+ *
+ * @param frame The received bytes of the frame
+ * @param available The number of bytes received so far
+ * @return int16_t The total frame length in bytes, -1 if more bytes are needed or 0 if this is not a valid frame
+ */
+int16_t P1Decryptor::FrameLength(const uint8_t *frame, uint16_t available) {
+    uint16_t lengthIndex = 2 + DLMS_SYSTEM_TITLE_SIZE;
+    if (available < 2) return -1;
+    if (frame[0] != DLMS_GENERAL_GLO_CIPHERING || frame[1] != DLMS_SYSTEM_TITLE_SIZE) return 0;
+    if (available <= lengthIndex) return -1;
+
+    uint16_t headerLength, payloadLength;
+    if (frame[lengthIndex] < 0x80) { // Short form length
+        headerLength = lengthIndex + 1;
+        payloadLength = frame[lengthIndex];
+    } else if (frame[lengthIndex] == 0x81) {
+        if (available <= lengthIndex + 1) return -1;
+        headerLength = lengthIndex + 2;
+        payloadLength = frame[lengthIndex + 1];
+    } else if (frame[lengthIndex] == 0x82) {
+        if (available <= lengthIndex + 2) return -1;
+        headerLength = lengthIndex + 3;
+        payloadLength = ((uint16_t)frame[lengthIndex + 1] << 8) | frame[lengthIndex + 2];
+    } else {
+        return 0;
+    }
+
+    if (payloadLength < 1 + DLMS_FRAME_COUNTER_SIZE || payloadLength > 0x7FFF - headerLength) return 0;
+    return headerLength + payloadLength;
+}
+
+/**
+ * @brief Verifies and decrypts a complete frame. The plain text telegram is moved to the start of the frame buffer
+ *
+ * @param frame The complete frame, overwritten by the plain text
+ * @param length The frame length as returned by @see FrameLength
+ * @return int16_t The length of the plain text or -1 if the frame is invalid or failed authentication
+ */
+int16_t P1Decryptor::Decrypt(uint8_t *frame, uint16_t length) {
+    int16_t frameLength = FrameLength(frame, length);
+    if (frameLength <= 0 || frameLength > length) return -1;
+
+    uint16_t index = 2 + DLMS_SYSTEM_TITLE_SIZE;
+    index += (frame[index] < 0x80) ? 1 : (frame[index] == 0x81 ? 2 : 3);
+
+    uint8_t securityControl = frame[index];
+    bool authenticated = (securityControl & DLMS_SECURITY_AUTHENTICATED) != 0;
+    bool encrypted = (securityControl & DLMS_SECURITY_ENCRYPTED) != 0;
+    // With a key a frame without a tag or encryption would skip the verification, no meter sends those so they are refused
+    if (hasAuthenticationKey && !(authenticated && encrypted)) return -1;
+    index++;
+
+    uint16_t cipherLength = frameLength - index - DLMS_FRAME_COUNTER_SIZE;
+    if (authenticated) {
+        if (cipherLength < DLMS_TAG_SIZE) return -1;
+        cipherLength -= DLMS_TAG_SIZE;
+    }
+
+    // IV = system title || frame counter
+    uint8_t iv[GCM_IV_SIZE];
+    memcpy(iv, frame + 2, DLMS_SYSTEM_TITLE_SIZE);
+    memcpy(iv + DLMS_SYSTEM_TITLE_SIZE, frame + index, DLMS_FRAME_COUNTER_SIZE);
+    memcpy(SystemTitle, frame + 2, DLMS_SYSTEM_TITLE_SIZE);
+    FrameCounter = ((uint32_t)frame[index] << 24) | ((uint32_t)frame[index + 1] << 16) | ((uint32_t)frame[index + 2] << 8) | frame[index + 3];
+    index += DLMS_FRAME_COUNTER_SIZE;
+
+    // AAD = security control byte || authentication key
+    uint8_t aad[1 + AES128_KEY_SIZE];
+    aad[0] = securityControl;
+    memcpy(aad + 1, authenticationKey, AES128_KEY_SIZE);
+
+    const uint8_t *tag = (authenticated && hasAuthenticationKey) ? frame + index + cipherLength : NULL;
+    if (!encrypted) {
+        // Without a key authentication only (GMAC) frames are passed through without verification
+    } else if (!cipher.Decrypt(iv, aad, sizeof(aad), frame + index, cipherLength, tag, DLMS_TAG_SIZE)) return -1;
+
+    memmove(frame, frame + index, cipherLength);
+    return cipherLength;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file P1Decryptor.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Unwraps and decrypts DLMS general-glo-ciphering frames as sent by the Luxembourg (Smarty) and Austrian smart meters
+ * @version 0.1
+ * @date 2022-01-15
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Frame layout: 0xDB, system title length (8), system title, length (BER encoded), security control byte, frame counter (4), cipher text, tag (12)
+ */
+
+#ifndef P1DECRYPTOR_H
+#define P1DECRYPTOR_H
+
+#include <Arduino.h>
+#include "AES128GCM.h"
+
+#define DLMS_GENERAL_GLO_CIPHERING  0xDB // Tag of the ciphered frame
+#define DLMS_SYSTEM_TITLE_SIZE      8
+#define DLMS_FRAME_COUNTER_SIZE     4
+#define DLMS_TAG_SIZE               12
+#define DLMS_SECURITY_AUTHENTICATED 0x10 // Security control bit indicating the frame carries an authentication tag
+#define DLMS_SECURITY_ENCRYPTED     0x20 // Security control bit indicating the frame is encrypted
+
+/**
+ * @brief Decrypts a DLMS ciphered frame in place so the resulting telegram can be parsed as usual
+ *
+ */
+class P1Decryptor {
+public:
+    P1Decryptor(const uint8_t *encryptionKey, const uint8_t *authenticationKey);
+
+    static int16_t FrameLength(const uint8_t *frame, uint16_t available);
+    int16_t Decrypt(uint8_t *frame, uint16_t length);
+
+    uint8_t SystemTitle[DLMS_SYSTEM_TITLE_SIZE];
+    uint32_t FrameCounter = 0;
+
+private:
+    AES128GCM cipher;
+    uint8_t authenticationKey[AES128_KEY_SIZE];
+    bool hasAuthenticationKey = false;
+};
+
+#endif // P1DECRYPTOR_H
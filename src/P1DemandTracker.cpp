@@ -0,0 +1,103 @@
+/**
+ * @file P1DemandTracker.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Quarter hour demand and monthly peak tracking for capacity tariffs
+ * @version 0.1
+ * @date 2022-01-29
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1DemandTracker.h"
+
+/**
+ * @brief Construct a new demand tracker
+ *
+ * @param minimumPeak The lowest value the monthly peak can have in watts. The Belgian capacity tariff uses 2500 W
+ */
+P1DemandTracker::P1DemandTracker(uint32_t minimumPeak) {
+    this->minimumPeak = minimumPeak;
+    MonthlyPeak = minimumPeak;
+}
+
+/**
+ * @brief Sets the function to call when a new monthly peak is about to be set
+ *
+ * @param callback The callback function @see P1PeakCallback
+ */
+void P1DemandTracker::OnPeakWarning(P1PeakCallback callback) {
+    peakCallback = callback;
+}
+
+/**
+ * @brief Updates the averages with a new telegram
+ *
+ * @param data The parsed telegram
+ */
+void P1DemandTracker::Update(const P1Data &data) {
+    uint32_t seconds = P1DateTimeToSeconds(data.DateTime);
+    if (seconds == 0) return;
+    uint32_t energy = data.DeliveredTariff1 + data.DeliveredTariff2; // Tariff switches don't affect the sum
+
+    if (quarterStart == 0 || seconds <= lastSeconds || energy < lastEnergy || seconds - lastSeconds > QUARTER_HOUR_SECONDS) {
+        // First telegram, clock or meter reset or a gap in the data. Start over from the next quarter hour boundary
+        quarterStart = seconds;
+        quarterStartEnergy = energy;
+        lastSeconds = seconds;
+        lastEnergy = energy;
+        AverageDemand = 0;
+        PredictedDemand = 0;
+        warned = false;
+        return;
+    }
+
+    uint32_t quarterEnd = (quarterStart / QUARTER_HOUR_SECONDS + 1) * QUARTER_HOUR_SECONDS;
+    if (seconds >= quarterEnd) {
+        // Interpolate the energy at the boundary between the last two telegrams
+        uint32_t energyAtEnd = lastEnergy + (uint32_t)((uint64_t)(energy - lastEnergy) * (quarterEnd - lastSeconds) / (seconds - lastSeconds));
+        completeQuarter(quarterEnd, energyAtEnd);
+    }
+
+    // The peak resets every month. Checked after completing the quarter hour as the one ending at midnight still counts for the old month
+    uint8_t currentMonth = (data.DateTime[2] - '0') * 10 + (data.DateTime[3] - '0');
+    if (currentMonth != month) {
+        month = currentMonth;
+        MonthlyPeak = minimumPeak;
+        MonthlyPeakDateTime = 0;
+    }
+
+    lastSeconds = seconds;
+    lastEnergy = energy;
+
+    uint32_t elapsed = seconds - quarterStart;
+    uint32_t remaining = QUARTER_HOUR_SECONDS - (seconds % QUARTER_HOUR_SECONDS);
+    uint32_t energyInQuarter = energy - quarterStartEnergy;
+
+    AverageDemand = elapsed == 0 ? 0 : (uint32_t)((uint64_t)energyInQuarter * 3600 / elapsed);
+    // Energy so far plus the actual power for the rest of the quarter hour, 1 Wh in a quarter hour averages to 4 W
+    PredictedDemand = energyInQuarter * 4 + (uint32_t)((uint64_t)data.ActualDelivered * remaining / QUARTER_HOUR_SECONDS);
+
+    if (!warned && PredictedDemand > MonthlyPeak && quarterStart % QUARTER_HOUR_SECONDS == 0) {
+        warned = true;
+        if (peakCallback != NULL) peakCallback(PredictedDemand, MonthlyPeak);
+    }
+}
+
+
+/***************** Helper functions *****************/
+
+void P1DemandTracker::completeQuarter(uint32_t quarterEnd, uint32_t energyAtEnd) {
+    // Only a quarter hour that was tracked from its start is a full quarter hour
+    if (quarterStart % QUARTER_HOUR_SECONDS == 0) {
+        LastQuarterDemand = (energyAtEnd - quarterStartEnergy) * 4;
+        if (LastQuarterDemand > MonthlyPeak) {
+            MonthlyPeak = LastQuarterDemand;
+            MonthlyPeakDateTime = quarterEnd;
+        }
+    }
+
+    quarterStart = quarterEnd;
+    quarterStartEnergy = energyAtEnd;
+    warned = false;
+}
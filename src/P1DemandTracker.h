@@ -0,0 +1,60 @@
+/**
+ * @file P1DemandTracker.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Quarter hour demand and monthly peak tracking for capacity tariffs
+ * @version 0.1
+ * @date 2022-01-29
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The quarter hour average is derived from the delivered energy registers, the same way the meter computes its own 1-0:1.4.0 value
+ */
+
+#ifndef P1DEMANDTRACKER_H
+#define P1DEMANDTRACKER_H
+
+#include <Arduino.h>
+#include "P1MeterParser.h"
+
+#define QUARTER_HOUR_SECONDS 900
+
+/**
+ * @brief Called once per quarter hour when the predicted average will exceed the monthly peak
+ *
+ * @param predictedDemand The predicted average of the running quarter hour in watts
+ * @param monthlyPeak The current monthly peak in watts
+ */
+typedef void (*P1PeakCallback)(uint32_t predictedDemand, uint32_t monthlyPeak);
+
+/**
+ * @brief Tracks the running quarter hour average demand and the monthly peak. Every update is O(1) so it can run on every telegram
+ *
+ */
+class P1DemandTracker {
+public:
+    P1DemandTracker(uint32_t minimumPeak = 0);
+
+    void Update(const P1Data &data);
+    void OnPeakWarning(P1PeakCallback callback);
+
+    uint32_t AverageDemand = 0; // Average of the running quarter hour so far in watts
+    uint32_t PredictedDemand = 0; // Expected average at the end of the running quarter hour in watts
+    uint32_t LastQuarterDemand = 0; // Average of the last completed quarter hour in watts
+    uint32_t MonthlyPeak = 0; // Highest completed quarter hour average of this month in watts
+    uint32_t MonthlyPeakDateTime = 0; // End of the peak quarter hour in seconds since 2000-01-01
+
+private:
+    void completeQuarter(uint32_t quarterEnd, uint32_t energyAtEnd);
+
+    P1PeakCallback peakCallback = NULL;
+    uint32_t minimumPeak;
+
+    uint32_t quarterStart = 0; // Seconds since 2000-01-01, 0 when not started
+    uint32_t quarterStartEnergy = 0; // Delivered energy at the start of the quarter hour in Wh
+    uint32_t lastSeconds = 0;
+    uint32_t lastEnergy = 0;
+    uint8_t month = 0;
+    bool warned = false;
+};
+
+#endif // P1DEMANDTRACKER_H
@@ -0,0 +1,73 @@
+/**
+ * @file P1Downsampler.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Aggregates telegrams into fixed intervals (1 minute, 15 minutes, hourly) of energy and power statistics
+ * @version 0.1
+ * @date 2022-02-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1Downsampler.h"
+#include "P1Register.h"
+
+/**
+ * @brief Construct a new downsampler
+ *
+ * @param intervalSeconds The interval length in seconds. Intervals are aligned to multiples of this length, e.g. @see INTERVAL_QUARTER_HOUR
+ * @param callback The function called with every completed interval
+ */
+P1Downsampler::P1Downsampler(uint32_t intervalSeconds, P1IntervalCallback callback) {
+    interval = intervalSeconds;
+    this->callback = callback;
+}
+
+/**
+ * @brief Adds a telegram. The record of the previous interval is emitted by the first telegram of a new interval
+ *
+ * @param data The parsed telegram
+ */
+void P1Downsampler::Update(const P1Data &data) {
+    uint32_t seconds = P1DateTimeToSeconds(data.DateTime);
+    if (seconds == 0) return;
+
+    if (!started) {
+        startInterval(seconds, data);
+        started = true;
+    } else if (seconds - record.Start >= interval || seconds < record.Start) {
+        // First telegram of a new interval closes the previous one
+        record.Delivered[0] = P1RegisterDelta(data.DeliveredTariff1, registers[0]);
+        record.Delivered[1] = P1RegisterDelta(data.DeliveredTariff2, registers[1]);
+        record.Produced[0] = P1RegisterDelta(data.ProducedTariff1, registers[2]);
+        record.Produced[1] = P1RegisterDelta(data.ProducedTariff2, registers[3]);
+        record.MeanPower = powerSum / record.Samples;
+
+        // The energy runs up to the first telegram of the next interval with telegrams, one or more intervals later
+        uint32_t next = seconds - seconds % interval;
+        record.End = next > record.Start ? next : record.Start + interval;
+
+        if (callback != NULL) callback(record);
+        startInterval(seconds, data);
+    }
+
+    int32_t power = (int32_t)data.ActualDelivered - (int32_t)data.ActualProduced;
+    if (record.Samples == 0 || power < record.MinPower) record.MinPower = power;
+    if (record.Samples == 0 || power > record.MaxPower) record.MaxPower = power;
+    powerSum += power;
+    record.Samples++;
+}
+
+
+/***************** Helper functions *****************/
+
+void P1Downsampler::startInterval(uint32_t seconds, const P1Data &data) {
+    memset(&record, 0, sizeof(record));
+    record.Start = seconds - seconds % interval;
+    powerSum = 0;
+
+    registers[0] = data.DeliveredTariff1;
+    registers[1] = data.DeliveredTariff2;
+    registers[2] = data.ProducedTariff1;
+    registers[3] = data.ProducedTariff2;
+}
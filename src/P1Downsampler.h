@@ -0,0 +1,69 @@
+/**
+ * @file P1Downsampler.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Aggregates telegrams into fixed intervals (1 minute, 15 minutes, hourly) of energy and power statistics
+ * @version 0.1
+ * @date 2022-02-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The interval energy is the difference of the registers in the first telegram of two successive intervals.
+ * This way the intervals add up exactly to the register readings, no energy is lost or counted twice. After a gap without
+ * telegrams the energy of the missing intervals is in the record before the gap, its End tells the period the energy covers
+ */
+
+#ifndef P1DOWNSAMPLER_H
+#define P1DOWNSAMPLER_H
+
+#include <Arduino.h>
+#include "P1MeterParser.h"
+
+#define INTERVAL_MINUTE         60
+#define INTERVAL_QUARTER_HOUR   900
+#define INTERVAL_HOUR           3600
+
+/**
+ * @brief Summary of a single interval
+ *
+ */
+struct P1IntervalRecord {
+    uint32_t Start; // Start of the interval in seconds since 2000-01-01, see P1DateTimeToSeconds
+    uint32_t End; // End of the period of the energy: Start + the interval length, later after a gap without telegrams
+    uint32_t Delivered[2]; // Energy delivered to the client per tariff in Wh
+    uint32_t Produced[2]; // Energy delivered by the client per tariff in Wh
+    int32_t MinPower; // Lowest net power (delivered - produced) in watts
+    int32_t MaxPower; // Highest net power in watts
+    int32_t MeanPower; // Average of the net power samples in watts
+    uint32_t Samples; // Number of telegrams in the interval, 86400 for a day of telegrams every second
+};
+
+/**
+ * @brief Called for every completed interval
+ *
+ * @param record The interval summary
+ */
+typedef void (*P1IntervalCallback)(const P1IntervalRecord &record);
+
+/**
+ * @brief Downsamples the telegrams to one record per interval
+ *
+ */
+class P1Downsampler {
+public:
+    P1Downsampler(uint32_t intervalSeconds, P1IntervalCallback callback);
+
+    void Update(const P1Data &data);
+
+private:
+    void startInterval(uint32_t seconds, const P1Data &data);
+
+    P1IntervalCallback callback;
+    uint32_t interval;
+
+    P1IntervalRecord record;
+    uint32_t registers[4]; // Delivered tariff 1 and 2, produced tariff 1 and 2 at the start of the interval
+    int64_t powerSum;
+    bool started = false;
+};
+
+#endif // P1DOWNSAMPLER_H
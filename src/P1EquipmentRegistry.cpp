@@ -0,0 +1,152 @@
+/**
+ * @file P1EquipmentRegistry.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Maps equipment identifiers of meters and M-Bus devices to small integer handles
+ * @version 0.1
+ * @date 2022-04-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1EquipmentRegistry.h"
+
+/**
+ * @brief Construct a new registry
+ *
+ * @param capacity The maximum number of identifiers. Handles run from 0 up to capacity - 1
+ */
+P1EquipmentRegistry::P1EquipmentRegistry(uint16_t capacity) {
+    if (capacity > 0x7FFF) capacity = 0x7FFF; // Keeps the slot count and the handles within 16 bits
+    this->capacity = capacity;
+
+    uint32_t slotCount = 2; // Up to 65536 slots
+    while (slotCount < 2 * capacity) slotCount *= 2;
+    slotMask = slotCount - 1;
+
+    equipmentIDs = new char[capacity][P1_EQUIPMENT_ID_SIZE];
+    hashes = new uint32_t[capacity];
+    slots = new uint16_t[slotCount];
+    Clear();
+}
+
+P1EquipmentRegistry::~P1EquipmentRegistry() {
+    delete[] equipmentIDs;
+    delete[] hashes;
+    delete[] slots;
+}
+
+/**
+ * @brief Gets the handle of an identifier, assigning the next free handle when it is new
+ *
+ * @param equipmentID The decoded identifier, e.g. P1Data::EquipmentID
+ * @return uint16_t The handle or EQUIPMENT_HANDLE_NONE when the identifier is empty or the registry is full
+ */
+uint16_t P1EquipmentRegistry::Intern(const char *equipmentID) {
+    uint8_t length = strnlen(equipmentID, P1_EQUIPMENT_ID_SIZE - 1);
+    if (length == 0) return EQUIPMENT_HANDLE_NONE;
+
+    // Telegrams of the same meter repeat the same identifiers
+    for (uint8_t i = 0; i < EQUIPMENT_RECENT_IDS; i++) {
+        if (recent[i].length == length && memcmp(recent[i].equipmentID, equipmentID, length) == 0) return recent[i].handle;
+    }
+
+    uint16_t handle = lookup(equipmentID, length, true);
+    if (handle != EQUIPMENT_HANDLE_NONE) {
+        recentID &entry = recent[nextRecent];
+        memcpy(entry.equipmentID, equipmentID, length);
+        entry.length = length;
+        entry.handle = handle;
+        nextRecent = (nextRecent + 1) % EQUIPMENT_RECENT_IDS;
+    }
+    return handle;
+}
+
+/**
+ * @brief Gets the handles of the meter and its M-Bus devices
+ *
+ * @param data The parsed telegram
+ * @return P1EquipmentHandles The handles, EQUIPMENT_HANDLE_NONE for channels without a device
+ */
+P1EquipmentHandles P1EquipmentRegistry::Intern(const P1Data &data) {
+    P1EquipmentHandles handles;
+    handles.Meter = Intern(data.EquipmentID);
+    for (uint8_t i = 0; i < 3; i++) {
+        handles.MBusDevices[i] = Intern(data.MBusDevices[i].EquipmentID);
+    }
+    return handles;
+}
+
+/**
+ * @brief Gets the handle of an identifier without adding it
+ *
+ * @return uint16_t The handle or EQUIPMENT_HANDLE_NONE when it is not registered
+ */
+uint16_t P1EquipmentRegistry::Find(const char *equipmentID) {
+    uint8_t length = strnlen(equipmentID, P1_EQUIPMENT_ID_SIZE - 1);
+    if (length == 0) return EQUIPMENT_HANDLE_NONE;
+    return lookup(equipmentID, length, false);
+}
+
+/**
+ * @brief Gets the identifier of a handle
+ *
+ * @return const char* The zero terminated identifier or NULL for an unused handle
+ */
+const char *P1EquipmentRegistry::EquipmentID(uint16_t handle) {
+    if (handle >= count) return NULL;
+    return equipmentIDs[handle];
+}
+
+/**
+ * @brief Gets the number of registered identifiers, which is also the next handle
+ *
+ */
+uint16_t P1EquipmentRegistry::Count() {
+    return count;
+}
+
+/**
+ * @brief Removes all identifiers. Handles are assigned from 0 again
+ *
+ */
+void P1EquipmentRegistry::Clear() {
+    count = 0;
+    memset(slots, 0xFF, (slotMask + 1) * sizeof(uint16_t)); // All EQUIPMENT_HANDLE_NONE
+    memset(recent, 0, sizeof(recent));
+    nextRecent = 0;
+}
+
+/***************** Helper functions *****************/
+
+uint16_t P1EquipmentRegistry::lookup(const char *equipmentID, uint8_t length, bool insert) {
+    uint32_t idHash = hash(equipmentID, length);
+
+    // Open addressing with linear probing, there is always a free slot as the table is at most half full
+    for (uint16_t slot = idHash & slotMask;; slot = (slot + 1) & slotMask) {
+        uint16_t handle = slots[slot];
+        if (handle == EQUIPMENT_HANDLE_NONE) {
+            if (!insert || count >= capacity) return EQUIPMENT_HANDLE_NONE;
+
+            handle = count++;
+            memcpy(equipmentIDs[handle], equipmentID, length);
+            equipmentIDs[handle][length] = 0;
+            hashes[handle] = idHash;
+            slots[slot] = handle;
+            return handle;
+        }
+
+        if (hashes[handle] == idHash && strncmp(equipmentIDs[handle], equipmentID, length) == 0 && equipmentIDs[handle][length] == 0) {
+            return handle;
+        }
+    }
+}
+
+uint32_t P1EquipmentRegistry::hash(const char *equipmentID, uint8_t length) {
+    // FNV-1a
+    uint32_t result = 2166136261UL;
+    for (uint8_t i = 0; i < length; i++) {
+        result = (result ^ (uint8_t)equipmentID[i]) * 16777619UL;
+    }
+    return result;
+}
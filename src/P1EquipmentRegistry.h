@@ -0,0 +1,70 @@
+/**
+ * @file P1EquipmentRegistry.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Maps equipment identifiers of meters and M-Bus devices to small integer handles
+ * @version 0.1
+ * @date 2022-04-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Meant for gateways receiving telegrams of many meters. Every identifier gets the next free handle the first time it is seen,
+ * so the state of a meter can be kept in an array indexed by its handle. The last identifiers are kept to recognise repeated ones
+ * by a memcmp, others are found through a hash table. Not thread safe
+ */
+
+#ifndef P1EQUIPMENTREGISTRY_H
+#define P1EQUIPMENTREGISTRY_H
+
+#include <Arduino.h>
+#include "P1MeterParser.h"
+
+#define EQUIPMENT_HANDLE_NONE   0xFFFF // Empty identifier or the registry is full
+#define EQUIPMENT_RECENT_IDS    4 // The meter and its M-Bus devices
+
+/**
+ * @brief Handles of all identifiers in a telegram
+ *
+ */
+struct P1EquipmentHandles {
+    uint16_t Meter;
+    uint16_t MBusDevices[3];
+};
+
+/**
+ * @brief Interning table of equipment identifiers
+ *
+ */
+class P1EquipmentRegistry {
+public:
+    P1EquipmentRegistry(uint16_t capacity);
+    ~P1EquipmentRegistry();
+
+    uint16_t Intern(const char *equipmentID);
+    P1EquipmentHandles Intern(const P1Data &data);
+    uint16_t Find(const char *equipmentID);
+    const char *EquipmentID(uint16_t handle);
+    uint16_t Count();
+    void Clear();
+
+private:
+    uint16_t lookup(const char *equipmentID, uint8_t length, bool insert);
+    static uint32_t hash(const char *equipmentID, uint8_t length);
+
+    uint16_t capacity;
+    uint16_t count = 0;
+    uint16_t slotMask; // Number of hash slots minus 1, at least twice the capacity
+
+    char (*equipmentIDs)[P1_EQUIPMENT_ID_SIZE];
+    uint32_t *hashes; // Per handle, compared before the identifiers
+    uint16_t *slots; // Handle per hash slot
+
+    struct recentID {
+        char equipmentID[P1_EQUIPMENT_ID_SIZE];
+        uint8_t length;
+        uint16_t handle;
+    };
+    recentID recent[EQUIPMENT_RECENT_IDS];
+    uint8_t nextRecent = 0;
+};
+
+#endif // P1EQUIPMENTREGISTRY_H
@@ -0,0 +1,57 @@
+/**
+ * @file P1FlowEstimator.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Flow rate and daily totals of the M-Bus devices (gas, water, thermal)
+ * @version 0.1
+ * @date 2022-02-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1FlowEstimator.h"
+
+/**
+ * @brief Updates the channels with the readings of a new telegram
+ *
+ * @param data The parsed telegram
+ * @return true When at least one channel had a new reading
+ * @return false When all readings were repeated from the previous telegram
+ */
+bool P1FlowEstimator::Update(const P1Data &data) {
+    bool updated = false;
+
+    for (uint8_t i = 0; i < MBUS_CHANNELS; i++) {
+        const MBusReading &reading = data.MBusDevices[i].Reading;
+        channelState &channel = state[i];
+
+        if (reading.DateTime[0] == 0) continue; // No device on this channel
+        if (channel.started && memcmp(reading.DateTime, channel.dateTime, P1_DATETIME_LENGTH) == 0) continue; // Repeated reading
+
+        uint32_t seconds = P1DateTimeToSeconds(reading.DateTime);
+        if (seconds == 0) continue;
+
+        P1FlowChannel &output = Channels[i];
+        if (!channel.started || reading.Value < channel.value || seconds <= output.LastReading) {
+            // First reading, meter replaced or clock set back
+            memset(&output, 0, sizeof(output));
+            channel.dayStartValue = reading.Value;
+            channel.started = true;
+        } else {
+            output.FlowRate = (uint32_t)((uint64_t)(reading.Value - channel.value) * 3600 / (seconds - output.LastReading));
+
+            if (memcmp(reading.DateTime, channel.dateTime, 6) != 0) { // YYMMDD changed, the first reading of the day closes the previous one
+                output.Yesterday = reading.Value - channel.dayStartValue;
+                channel.dayStartValue = reading.Value;
+            }
+        }
+
+        memcpy(channel.dateTime, reading.DateTime, P1_DATETIME_LENGTH);
+        channel.value = reading.Value;
+        output.Today = reading.Value - channel.dayStartValue;
+        output.LastReading = seconds;
+        updated = true;
+    }
+
+    return updated;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file P1FlowEstimator.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Flow rate and daily totals of the M-Bus devices (gas, water, thermal)
+ * @version 0.1
+ * @date 2022-02-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note M-Bus devices report a new reading every 5 minutes (hourly on DSMR 4.x gas meters) which is repeated in every telegram until the next one.
+ * Repeated readings are recognised by their timestamp and skipped
+ */
+
+#ifndef P1FLOWESTIMATOR_H
+#define P1FLOWESTIMATOR_H
+
+#include <Arduino.h>
+#include "P1MeterParser.h"
+
+#define MBUS_CHANNELS 3 // Same as the number of MBusDevices in P1Data
+
+/**
+ * @brief Derived values of a single M-Bus channel. Values are in thousandths of the device unit, e.g. dm3 for a gas meter in m3
+ *
+ */
+struct P1FlowChannel {
+    uint32_t FlowRate; // Average flow between the last two readings in thousandths of the unit per hour
+    uint32_t Today; // Consumption since the first reading of today (normally the one at 00:00)
+    uint32_t Yesterday; // Consumption of the previous day
+    uint32_t LastReading; // Timestamp of the last reading in seconds since 2000-01-01
+};
+
+/**
+ * @brief Estimates the flow rate and daily totals for each M-Bus channel
+ *
+ */
+class P1FlowEstimator {
+public:
+    bool Update(const P1Data &data);
+
+    P1FlowChannel Channels[MBUS_CHANNELS] = {};
+
+private:
+    struct channelState {
+        char dateTime[P1_DATETIME_LENGTH]; // Raw timestamp of the last reading, compared to skip repeated readings
+        uint32_t value;
+        uint32_t dayStartValue;
+        bool started;
+    };
+
+    channelState state[MBUS_CHANNELS] = {};
+};
+
+#endif // P1FLOWESTIMATOR_H
@@ -0,0 +1,122 @@
+/**
+ * @file P1Hex.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Decoding of the hex encoded values in the P1 telegram (equipment identifiers and text messages)
+ * @version 0.1
+ * @date 2022-04-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note A 256 byte lookup table decodes one character per lookup. On a host with SSSE3 or NEON 16 characters are decoded at once
+ */
+
+#ifndef P1HEX_H
+#define P1HEX_H
+
+#include <Arduino.h>
+
+#if defined(__SSSE3__) && (defined(__x86_64__) || defined(__i386__))
+#define P1HEX_USE_SSSE3
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define P1HEX_USE_NEON
+#include <arm_neon.h>
+#endif
+
+#define HEX_INVALID 0xFF
+
+// Value of every character, HEX_INVALID for characters which are no hex digit
+static const uint8_t HEX_VALUES[256] PROGMEM = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+#if defined(P1HEX_USE_SSSE3)
+/**
+ * @brief Decodes 16 hex characters into 8 bytes
+ *
+ * @return bool False when one of the characters is no hex digit
+ */
+inline bool P1DecodeHex16(const char *hex, char *output) {
+    __m128i input = _mm_loadu_si128((const __m128i *)hex);
+
+    __m128i digit = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(input, _mm_set1_epi8(0x20)), _mm_set1_epi8('a')); // Lower case
+    __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(digit, _mm_set1_epi8(-1)), _mm_cmplt_epi8(digit, _mm_set1_epi8(10)));
+    __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(letter, _mm_set1_epi8(-1)), _mm_cmplt_epi8(letter, _mm_set1_epi8(6)));
+    if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xFFFF) return false;
+
+    __m128i nibbles = _mm_or_si128(_mm_and_si128(isDigit, digit), _mm_andnot_si128(isDigit, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+    __m128i bytes = _mm_maddubs_epi16(nibbles, _mm_set1_epi16(0x0110)); // High nibble * 16 + low nibble
+    _mm_storel_epi64((__m128i *)output, _mm_packus_epi16(bytes, bytes));
+    return true;
+}
+#elif defined(P1HEX_USE_NEON)
+inline bool P1DecodeHex16(const char *hex, char *output) {
+    uint8x8x2_t input = vld2_u8((const uint8_t *)hex); // High nibbles in val[0], low nibbles in val[1]
+    uint8x8_t nibbles[2];
+
+    for (uint8_t i = 0; i < 2; i++) {
+        uint8x8_t digit = vsub_u8(input.val[i], vdup_n_u8('0'));
+        uint8x8_t letter = vsub_u8(vorr_u8(input.val[i], vdup_n_u8(0x20)), vdup_n_u8('a'));
+        uint8x8_t isDigit = vclt_u8(digit, vdup_n_u8(10));
+        uint8x8_t isLetter = vclt_u8(letter, vdup_n_u8(6));
+        if (vget_lane_u64(vreinterpret_u64_u8(vorr_u8(isDigit, isLetter)), 0) != 0xFFFFFFFFFFFFFFFFULL) return false;
+        nibbles[i] = vbsl_u8(isDigit, digit, vadd_u8(letter, vdup_n_u8(10)));
+    }
+
+    vst1_u8((uint8_t *)output, vorr_u8(vshl_n_u8(nibbles[0], 4), nibbles[1]));
+    return true;
+}
+#endif
+
+/**
+ * @brief Decodes a hex encoded value, e.g. 4530303331 into E0031. Values which are not hex encoded are copied as they are
+ *
+ * @param hex The hex characters
+ * @param length The number of hex characters
+ * @param output Receives the zero terminated result
+ * @param size The size of output including the terminator. Longer values are cut off
+ * @return uint16_t The length of the result
+ */
+inline uint16_t P1DecodeHex(const char *hex, uint16_t length, char *output, uint16_t size) {
+    uint16_t outputLength = length / 2;
+    if (outputLength > size - 1) outputLength = size - 1;
+
+    uint16_t i = 0;
+    bool valid = (length & 1) == 0;
+#if defined(P1HEX_USE_SSSE3) || defined(P1HEX_USE_NEON)
+    for (; valid && i + 8 <= outputLength; i += 8) {
+        valid = P1DecodeHex16(hex + 2 * i, output + i);
+    }
+#endif
+    for (; valid && i < outputLength; i++) {
+        uint8_t high = pgm_read_byte(&HEX_VALUES[(uint8_t)hex[2 * i]]);
+        uint8_t low = pgm_read_byte(&HEX_VALUES[(uint8_t)hex[2 * i + 1]]);
+        valid = (high | low) != HEX_INVALID;
+        output[i] = (high << 4) | low;
+    }
+
+    if (!valid) { // Not hex encoded
+        outputLength = length > size - 1 ? size - 1 : length;
+        memcpy(output, hex, outputLength);
+    }
+    output[outputLength] = 0;
+    return outputLength;
+}
+
+#endif // P1HEX_H
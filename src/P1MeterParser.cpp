@@ -9,15 +9,85 @@
  * 
  */
 
+#include <stddef.h>
 #include "P1MeterParser.h"
 #include "CRC16.h"
+#include "P1Replayer.h"
+
+/**
+ * @brief Kinds of single values, each with one shared decoder
+ * 
+ */
+enum EP1ValueKind {
+    FixedPointValue,    // uint32_t scaled by the number of decimals
+    ByteValue,          // byte
+    DateTimeValue,      // char[14] timestamp
+    HexValue            // Hex encoded text, decoded into a char array. The decimals hold the hex cache slot
+};
+
+#define HEX_SLOT_EQUIPMENT_ID   0
+#define HEX_SLOT_TEXT_MESSAGE   1
+#define HEX_SLOT_MBUS           2 // Up to 4 for the 3 channels
+
+/**
+ * @brief Describes where and how a single value line is stored in @see P1Data
+ * 
+ */
+struct P1ValueDecoder {
+    uint32_t Key; // OBIS_KEY of the line
+    uint16_t Offset; // Offset of the field in P1Data
+    uint8_t Kind; // EP1ValueKind in the low nibble, EP1Unit of the field in the high nibble
+    uint8_t Decimals; // For FixedPointValue
+    uint8_t Column; // EP1Column when parsing into a P1ColumnBatch
+};
+
+#define VALUE_DECODER(a, c, d, e, field, kind, unit, decimals, column) { OBIS_KEY(a, c, d, e), (uint16_t)offsetof(P1Data, field), (uint8_t)((kind) | (unit) << 4), decimals, column }
+
+// Sorted by key for the binary search in decodeValue
+static const P1ValueDecoder valueDecoders[] PROGMEM = {
+    VALUE_DECODER(0, 1, 0, 0, DateTime, DateTimeValue, Unit_None, 0, Column_DateTime),                        // OBIS_DATETIME
+    VALUE_DECODER(0, 96, 1, 1, EquipmentID, HexValue, Unit_None, HEX_SLOT_EQUIPMENT_ID, Column_None),         // OBIS_EQUIPMENTID
+    VALUE_DECODER(0, 96, 7, 9, LongPowerFailures, FixedPointValue, Unit_None, 0, Column_LongPowerFailures),   // OBIS_LONG_POWER_FAIL
+    VALUE_DECODER(0, 96, 7, 21, PowerFailures, FixedPointValue, Unit_None, 0, Column_PowerFailures),          // OBIS_NUMBER_POWER_FAIL
+    VALUE_DECODER(0, 96, 13, 0, TextMessage, HexValue, Unit_None, HEX_SLOT_TEXT_MESSAGE, Column_None),        // OBIS_TEXT_MESSAGE
+    VALUE_DECODER(0, 96, 14, 0, CurrentTariff, ByteValue, Unit_None, 0, Column_CurrentTariff),                // OBIS_TARIFF_INDICATOR
+#if P1_PROFILES & P1_PROFILE_EMUCS
+    VALUE_DECODER(1, 1, 4, 0, AverageDemand, FixedPointValue, Unit_kW, 3, Column_AverageDemand),              // OBIS_AVERAGE_DEMAND
+#endif
+    VALUE_DECODER(1, 1, 7, 0, ActualDelivered, FixedPointValue, Unit_kW, 3, Column_ActualDelivered),          // OBIS_ACTUAL_DELIVERED
+    VALUE_DECODER(1, 1, 8, 1, DeliveredTariff1, FixedPointValue, Unit_kWh, 3, Column_DeliveredTariff1),       // OBIS_TARIFF1_DELIVERED
+    VALUE_DECODER(1, 1, 8, 2, DeliveredTariff2, FixedPointValue, Unit_kWh, 3, Column_DeliveredTariff2),       // OBIS_TARIFF2_DELIVERED
+    VALUE_DECODER(1, 2, 7, 0, ActualProduced, FixedPointValue, Unit_kW, 3, Column_ActualProduced),            // OBIS_ACTUAL_PRODUCED
+    VALUE_DECODER(1, 2, 8, 1, ProducedTariff1, FixedPointValue, Unit_kWh, 3, Column_ProducedTariff1),         // OBIS_TARIFF1_PRODUCED
+    VALUE_DECODER(1, 2, 8, 2, ProducedTariff2, FixedPointValue, Unit_kWh, 3, Column_ProducedTariff2),         // OBIS_TARIFF2_PRODUCED
+    VALUE_DECODER(1, 21, 7, 0, PowerDelivered[0], FixedPointValue, Unit_kW, 3, Column_PowerDeliveredL1),      // OBIS_POWER_POS_L1
+    VALUE_DECODER(1, 22, 7, 0, PowerProduced[0], FixedPointValue, Unit_kW, 3, Column_PowerProducedL1),        // OBIS_POWER_NEG_L1
+    VALUE_DECODER(1, 31, 7, 0, Current[0], FixedPointValue, Unit_A, 0, Column_CurrentL1),                     // OBIS_CURRENT_L1
+    VALUE_DECODER(1, 32, 7, 0, Voltage[0], FixedPointValue, Unit_V, 1, Column_VoltageL1),                     // OBIS_VOLTAGE_L1
+    VALUE_DECODER(1, 32, 32, 0, VoltageSags[0], FixedPointValue, Unit_None, 0, Column_VoltageSagsL1),         // OBIS_NUM_VOLTAGE_SAG_L1
+    VALUE_DECODER(1, 32, 36, 0, VoltageSwells[0], FixedPointValue, Unit_None, 0, Column_VoltageSwellsL1),     // OBIS_NUM_VOLTAGE_SWL_L1
+    VALUE_DECODER(1, 41, 7, 0, PowerDelivered[1], FixedPointValue, Unit_kW, 3, Column_PowerDeliveredL2),      // OBIS_POWER_POS_L2
+    VALUE_DECODER(1, 42, 7, 0, PowerProduced[1], FixedPointValue, Unit_kW, 3, Column_PowerProducedL2),        // OBIS_POWER_NEG_L2
+    VALUE_DECODER(1, 51, 7, 0, Current[1], FixedPointValue, Unit_A, 0, Column_CurrentL2),                     // OBIS_CURRENT_L2
+    VALUE_DECODER(1, 52, 7, 0, Voltage[1], FixedPointValue, Unit_V, 1, Column_VoltageL2),                     // OBIS_VOLTAGE_L2
+    VALUE_DECODER(1, 52, 32, 0, VoltageSags[1], FixedPointValue, Unit_None, 0, Column_VoltageSagsL2),         // OBIS_NUM_VOLTAGE_SAG_L2
+    VALUE_DECODER(1, 52, 36, 0, VoltageSwells[1], FixedPointValue, Unit_None, 0, Column_VoltageSwellsL2),     // OBIS_NUM_VOLTAGE_SWL_L2
+    VALUE_DECODER(1, 61, 7, 0, PowerDelivered[2], FixedPointValue, Unit_kW, 3, Column_PowerDeliveredL3),      // OBIS_POWER_POS_L3
+    VALUE_DECODER(1, 62, 7, 0, PowerProduced[2], FixedPointValue, Unit_kW, 3, Column_PowerProducedL3),        // OBIS_POWER_NEG_L3
+    VALUE_DECODER(1, 71, 7, 0, Current[2], FixedPointValue, Unit_A, 0, Column_CurrentL3),                     // OBIS_CURRENT_L3
+    VALUE_DECODER(1, 72, 7, 0, Voltage[2], FixedPointValue, Unit_V, 1, Column_VoltageL3),                     // OBIS_VOLTAGE_L3
+    VALUE_DECODER(1, 72, 32, 0, VoltageSags[2], FixedPointValue, Unit_None, 0, Column_VoltageSagsL3),         // OBIS_NUM_VOLTAGE_SAG_L3
+    VALUE_DECODER(1, 72, 36, 0, VoltageSwells[2], FixedPointValue, Unit_None, 0, Column_VoltageSwellsL3)      // OBIS_NUM_VOLTAGE_SWL_L3
+};
+
+#define VALUE_DECODER_COUNT (sizeof(valueDecoders) / sizeof(valueDecoders[0]))
 
 /**
  * @brief Basic constructor with only a serial object. Make sure that the CTS pin of the P1 connection is pulled high
  * 
- * @param serial The Hardware serial port to which the P1 meter is attached to
+ * @param serial The Hardware serial port to which the P1 meter is attached to. Any Stream works, e.g. a @see P1Replayer
  */
-P1Meter::P1Meter(HardwareSerial *serial) {
+P1Meter::P1Meter(Stream *serial) {
     // Serial P1 connection
     mySerial = serial;
 
@@ -25,7 +95,7 @@ P1Meter::P1Meter(HardwareSerial *serial) {
     char *newBuffer = (char *)realloc(buffer, BUFFER_SIZE + 1);
     buffer = newBuffer;
 
-    memset(buffer, 0, BUFFER_SIZE);
+    memset(buffer, 0, BUFFER_SIZE + 1); // The last byte always terminates the buffer
     bufferIndex = 0;
 }
 
@@ -35,7 +105,7 @@ P1Meter::P1Meter(HardwareSerial *serial) {
  * @param serial The Hardware serial port to which the P1 meter is attached to
  * @param ctsPin The arduino pin which is connected to the CTS pin of the P1 Smart meter connection
  */
-P1Meter::P1Meter(HardwareSerial *serial, uint8_t ctsPin) {
+P1Meter::P1Meter(Stream *serial, uint8_t ctsPin) {
     this->ctsPin = ctsPin;
     
     // Serial P1 connection
@@ -45,15 +115,82 @@ P1Meter::P1Meter(HardwareSerial *serial, uint8_t ctsPin) {
     char *newBuffer = (char *)realloc(buffer, BUFFER_SIZE + 1);
     buffer = newBuffer;
 
-    memset(buffer, 0, BUFFER_SIZE);
+    memset(buffer, 0, BUFFER_SIZE + 1); // The last byte always terminates the buffer
     bufferIndex = 0;
 }
 
+P1Meter::~P1Meter() {
+    free(buffer);
+    delete decryptor;
+}
+
 /**
  * @brief Receives the telegram. This function is non-blocking as long as there is no telegram send. When the telegram is send this function will block untill it is fully received
+ * or no byte arrived for RECEIVE_TIMEOUT milliseconds, which sets Incomplete instead of DataReady
+ * @note In duty cycled mode (@see SetReadInterval) the request line is only raised when a reading is due and corrupt telegrams are skipped,
+ * so DataReady is only set for a valid telegram
  * 
  */
 void P1Meter::ReceiveTelegram() {
+    if (readInterval != 0 && !reading && !startReading()) return;
+
+    uint32_t startMicros = micros();
+    receive();
+    currentStats.CpuMicros += micros() - startMicros;
+
+    if (reading && DataReady) {
+        currentStats.Telegrams++;
+        if (!validTelegram()) { // Wait for the next telegram, the request line is raised again by receive
+            memset(buffer, 0, BUFFER_SIZE);
+            DataReady = false;
+            return;
+        }
+        finishReading();
+    } else if (reading && readTimeout != 0 && millis() - readingStart >= readTimeout) { // E.g. the meter doesn't answer the request
+        releaseRequest();
+        currentStats.TimedOut = true;
+        finishReading();
+    }
+}
+
+/**
+ * @brief Only raises the request line every interval, e.g. for battery powered nodes which need a reading every 10 to 60 seconds.
+ * In between ReceiveTelegram calls the sleep callback with the time left until the next reading
+ * 
+ * @param intervalMillis Time between the start of two readings. 0 disables the duty cycling
+ * @param sleepCallback Optional function putting the MCU to sleep. It may return early, e.g. when woken up by UART activity
+ * @param timeoutMillis Time a reading waits for a valid telegram. After it the request line is released and the reading is recorded
+ * as failed, @see P1ReadingStats::TimedOut. 0 waits forever
+ */
+void P1Meter::SetReadInterval(uint32_t intervalMillis, P1SleepCallback sleepCallback, uint32_t timeoutMillis) {
+    readInterval = intervalMillis;
+    readTimeout = timeoutMillis;
+    this->sleepCallback = sleepCallback;
+    readingDue = true;
+    lastReadingEnd = millis();
+}
+
+/**
+ * @brief Sets the supply current of the board to estimate the charge used per reading, @see P1ReadingStats
+ * 
+ * @param activeMicroamps Current while awake in uA
+ * @param sleepMicroamps Current while in the sleep callback in uA
+ */
+void P1Meter::SetSupplyCurrent(uint32_t activeMicroamps, uint32_t sleepMicroamps) {
+    activeCurrent = activeMicroamps;
+    sleepCurrent = sleepMicroamps;
+}
+
+/**
+ * @brief Gets the awake time, sleep time, CPU time and charge of the last reading in duty cycled mode, also when it timed out
+ * 
+ * @return P1ReadingStats The statistics of the last completed reading
+ */
+P1ReadingStats P1Meter::GetReadingStats() {
+    return lastStats;
+}
+
+void P1Meter::receive() {
     if (!ctsHigh && ctsPin != 0xFF) {
         pinMode(ctsPin, OUTPUT);
         digitalWrite(ctsPin, HIGH); // Clear to send. Receive data from the P1 meter
@@ -61,111 +198,127 @@ void P1Meter::ReceiveTelegram() {
     }
 
     if (mySerial->available()) {
-        uint8_t data = mySerial->read();
+        uint8_t data = readByte();
+        if (decryptor != NULL) {
+            if (data == DLMS_GENERAL_GLO_CIPHERING) { // Start of the encrypted frame
+                receiveEncryptedTelegram(data);
+            }
+            return;
+        }
+
         if (data != '/') { // Start of the telegram
             return;
         }
 
+        if (Incomplete) { // Clear the part of the telegram given up before
+            memset(buffer, 0, BUFFER_SIZE);
+            Incomplete = false;
+        }
         bufferIndex = 0;
         buffer[bufferIndex] = data;
-        bufferIndex++;
+        bool lineStart = false, lastLine = false;
+        uint32_t lastByte = millis();
 
         while (!DataReady) {
-            if (mySerial->available()) {
-                buffer[bufferIndex] = mySerial->read();
-                
-                if (buffer[bufferIndex - 6] == '!') { // End of telegram with CRC and \r\n after it
-                    DataReady = true;
-                    if (ctsPin != 0xFF) {
-                        // Setting CTS low is against the P1 standard. It should be set to high impedance / pinmode input could do it
-                        pinMode(ctsPin, INPUT); // Pause the telegram sending to be sure it won't mess up de rx buffer
-                        ctsHigh = false;
-                    }
-                } else {
-                    bufferIndex++;
+            if (!mySerial->available()) {
+                if (millis() - lastByte > RECEIVE_TIMEOUT) { // The meter stopped sending halfway
+                    Incomplete = true;
+                    return;
                 }
+                continue;
+            }
+
+            lastByte = millis();
+            char character = readByte();
+            if (bufferIndex < BUFFER_SIZE - 1) { // Overlong telegrams are cut off and fail the CRC check
+                buffer[++bufferIndex] = character;
+            }
+
+            if (lineStart) lastLine = character == '!';
+            lineStart = character == '\n';
+            if (lineStart && lastLine) { // End of telegram, with a CRC for DSMR 4 and later or without for DSMR 2.2 and 3.0
+                DataReady = true;
+                releaseRequest();
             }
         }
     }
 }
 
+/**
+ * @brief Enables the reception of encrypted telegrams. Once set @see ReceiveTelegram waits for DLMS ciphered frames instead of plain telegrams
+ * and decrypts them straight into the telegram buffer
+ * 
+ * @param encryptionKey The 16 byte encryption key as provided by the grid operator
+ * @param authenticationKey The 16 byte authentication key. Pass NULL to skip the authentication tag check
+ */
+void P1Meter::SetDecryptionKey(const uint8_t *encryptionKey, const uint8_t *authenticationKey) {
+    delete decryptor;
+    decryptor = new P1Decryptor(encryptionKey, authenticationKey);
+}
+
+/**
+ * @brief Records every received byte with the time since the previous byte, so timing related problems can be reproduced with a @see P1Replayer.
+ * Each byte takes the delta in microseconds as an unsigned LEB128 varint followed by the byte itself, mostly 2 or 3 bytes per received byte
+ * 
+ * @param recorder Where to write the recording, e.g. a File on an SD card or flash. Pass NULL to stop recording
+ */
+void P1Meter::SetRecorder(Print *recorder) {
+    this->recorder = recorder;
+    lastRecordMicros = micros();
+
+    if (recorder != NULL) {
+        recorder->write((const uint8_t *)REPLAY_MAGIC, REPLAY_MAGIC_LENGTH);
+    }
+}
+
 /**
  * @brief Parses the telegram and provides its data in an easily accessible struct @see P1Data
+ * @note Lines with a single value are looked up in a descriptor table and handled by one decoder per kind of value,
+ * records with more values are dispatched with a switch on the packed OBIS code. Either way every supported line or profile
+ * costs the same per line. Values are parsed up to their decimal point and unit, which covers the different digit widths of the DSMR versions
  * 
  * @return P1Data The parsed P1 telegram data
  */
 P1Data P1Meter::ProcessTelegram() {
+    uint32_t startMicros = micros();
+
     // Check the number of MBus devices attached
     data.NumberOfMBusDevices = strtoul(&buffer[lastIndexOf('-', 0) + 1], NULL, 10);
     
     int16_t startOfLine = 0, endOfLine = 0;
     startOfLine = indexOf('/', 0); // Find the first character of the telegram
     endOfLine = indexOf('\n', 0);
-    // Fill in the header info
-    data.HeaderInfo = getSubString(startOfLine + 1, endOfLine);
+    // Fill in the header info, unless a zero byte in a corrupted telegram hides the end of the line
+    data.HeaderInfo = startOfLine != -1 && endOfLine > startOfLine ? getSubString(startOfLine + 1, endOfLine) : String();
 
-    char valueBuffer[10];
+    EP1Profile detectedProfile = DSMR_2_2; // Until a version line says otherwise
+    bool hasVersion = false;
 
     // Parse the telegram
     while (endOfLine < bufferIndex && endOfLine != -1) {
         startOfLine = endOfLine + 1;
         endOfLine = indexOf('\n', startOfLine + 1);
 
-        memset(valueBuffer, 0, 10);
-
-        // Default OBIS codes
-        if (startsWith(OBIS_VERSION, startOfLine)) {
-            data.P1Version = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
-
-        } else if (startsWith(OBIS_DATETIME, startOfLine)) {
-            strncpy(data.DateTime, buffer + indexOf('(', startOfLine) + 1, 13);
-
-        } else if (startsWith(OBIS_EQUIPMENTID, startOfLine)) {
-            data.EquipmentID = getSubString(indexOf('(', startOfLine) + 1, endOfLine - 2);
-
-        } else if (startsWith(OBIS_TARIFF1_DELIVERED, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 6);
-            strncpy(&valueBuffer[6], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.DeliveredTariff1 = strtoul(valueBuffer, NULL, 10);
-
-        } else if (startsWith(OBIS_TARIFF2_DELIVERED, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 6);
-            strncpy(&valueBuffer[6], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.DeliveredTariff2 = strtoul(valueBuffer, NULL, 10);
-
-        } else if (startsWith(OBIS_TARIFF1_PRODUCED, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 6);
-            strncpy(&valueBuffer[6], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.ProducedTariff1 = strtoul(valueBuffer, NULL, 10);
-
-        } else if (startsWith(OBIS_TARIFF2_PRODUCED, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 6);
-            strncpy(&valueBuffer[6], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.ProducedTariff2 = strtoul(valueBuffer, NULL, 10);
-
-        } else if (startsWith(OBIS_TARIFF_INDICATOR, startOfLine)) {
-            data.CurrentTariff = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
-
-        } else if (startsWith(OBIS_ACTUAL_DELIVERED, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 2);
-            strncpy(&valueBuffer[2], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.ActualDelivered = strtoul(valueBuffer, NULL, 10);
-
-        } else if (startsWith(OBIS_ACTUAL_PRODUCED, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 2);
-            strncpy(&valueBuffer[2], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.ActualProduced = strtoul(valueBuffer, NULL, 10);
-
-        } else if (startsWith(OBIS_NUMBER_POWER_FAIL, startOfLine)) {
-            data.PowerFailures = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
-
-        } else if (startsWith(OBIS_LONG_POWER_FAIL, startOfLine)) {
-            data.LongPowerFailures = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
-
-        } else if (startsWith(OBIS_POWER_LOG, startOfLine)) {
-            uint16_t index1 = indexOf('(', startOfLine) + 1;
+        uint8_t channel;
+        int16_t valueIndex;
+        uint32_t key = parseObis(startOfLine, channel, valueIndex);
+        if (key == 0) continue; // Not an OBIS line, e.g. the end of the telegram
+        if (decodeValue(key, valueIndex, endOfLine)) continue; // Single values
+
+        // Records with more than one value
+        const char *value = buffer + valueIndex + 1;
+        switch (key) {
+        case OBIS_KEY(1, 0, 2, 8): // OBIS_VERSION
+            data.P1Version = strtoul(value, NULL, 10);
+            hasVersion = true;
+            detectedProfile = data.P1Version >= 50 ? DSMR_5 : DSMR_4;
+            break;
+
+        case OBIS_KEY(1, 99, 97, 0): { // OBIS_POWER_LOG
+            uint16_t index1 = valueIndex + 1;
             uint16_t index2 = index1 + 3;
             uint8_t numberOfLogs = strtoul(&buffer[index1], NULL, 10);
+            if (numberOfLogs > 3) numberOfLogs = 3;
             
             for (uint8_t i = 0; i < numberOfLogs; i++) {
                 index1 = indexOf('(', index2 + 1);
@@ -173,122 +326,219 @@ P1Data P1Meter::ProcessTelegram() {
                 index2 = indexOf('(', index1 + 1);
                 data.PowerFailureLogs[i].Duration = strtod(buffer + index2 + 1, NULL);
             }
+            break;
+        }
 
-        } else if (startsWith(OBIS_NUM_VOLTAGE_SAG_L1, startOfLine)) {
-            data.VoltageSags[0] = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
-
-        } else if (startsWith(OBIS_NUM_VOLTAGE_SAG_L2, startOfLine)) {
-            data.VoltageSags[1] = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
-        
-        } else if (startsWith(OBIS_NUM_VOLTAGE_SAG_L3, startOfLine)) {
-            data.VoltageSags[2] = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
-
-        } else if (startsWith(OBIS_NUM_VOLTAGE_SWL_L1, startOfLine)) {
-            data.VoltageSwells[0] = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
+        case OBIS_KEY(0, 24, 1, 0): // OBIS_DEVICE_TYPE
+            if (channel < 1 || channel > 3) break;
+            data.MBusDevices[channel - 1].DeviceType = (EMBusDeviceType)strtoul(value, NULL, 10);
+            break;
 
-        } else if (startsWith(OBIS_NUM_VOLTAGE_SWL_L2, startOfLine)) {
-            data.VoltageSwells[1] = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
+        case OBIS_KEY(0, 96, 1, 0): // OBIS_EQUIPMENT_IDENT
+            if (channel < 1 || channel > 3) break;
+            decodeHexValue(HEX_SLOT_MBUS + channel - 1, valueIndex, endOfLine, data.MBusDevices[channel - 1].EquipmentID, P1_EQUIPMENT_ID_SIZE);
+            break;
 
-        } else if (startsWith(OBIS_NUM_VOLTAGE_SWL_L3, startOfLine)) {
-            data.VoltageSwells[2] = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
+        case OBIS_KEY(0, 24, 2, 1): { // OBIS_DEVICE_VALUE
+            if (channel < 1 || channel > 3) break;
+            MBusReading &reading = data.MBusDevices[channel - 1].Reading;
+            strncpy(reading.DateTime, value, 13);
 
-        } else if (startsWith(OBIS_TEXT_MESSAGE, startOfLine)) {
-            data.TextMessage = getSubString(indexOf('(', startOfLine) + 1, endOfLine - 2);
+            valueIndex = indexOf('(', valueIndex + 1);
+            reading.Value = P1ParseFixedPoint(buffer + valueIndex + 1, 3);
+            reading.Unit = parseUnit(indexOf('*', valueIndex + 1), endOfLine);
+            break;
+        }
 
-        } else if (startsWith(OBIS_VOLTAGE_L1, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 3);
-            strncpy(&valueBuffer[3], buffer + indexOf('.', startOfLine + 10) + 1, 1);
-            data.Voltage[0] = strtoul(valueBuffer, NULL, 10);
+#if P1_PROFILES & P1_PROFILE_LEGACY
+        case OBIS_KEY(0, 24, 3, 0): { // OBIS_LEGACY_DEVICE_VALUE
+            // DSMR 2.2 and 3.0: (timestamp)(08)(60)(1)(0-n:24.2.1)(unit) with the value on the next line
+            if (channel < 1 || channel > 3) break;
+            MBusReading &reading = data.MBusDevices[channel - 1].Reading;
+            strncpy(reading.DateTime, value, 12); // No summer/winter flag
+            reading.DateTime[12] = 0;
 
-        } else if (startsWith(OBIS_VOLTAGE_L2, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 3);
-            strncpy(&valueBuffer[3], buffer + indexOf('.', startOfLine + 10) + 1, 1);
-            data.Voltage[1] = strtoul(valueBuffer, NULL, 10);
+            for (uint8_t i = 0; i < 5 && valueIndex != -1; i++) {
+                valueIndex = indexOf('(', valueIndex + 1);
+            }
+            if (valueIndex == -1) break;
+            reading.Unit = parseUnit(valueIndex, endOfLine);
 
-        } else if (startsWith(OBIS_VOLTAGE_L3, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 3);
-            strncpy(&valueBuffer[3], buffer + indexOf('.', startOfLine + 10) + 1, 1);
-            data.Voltage[2] = strtoul(valueBuffer, NULL, 10);
+            valueIndex = indexOf('(', endOfLine);
+            if (valueIndex == -1) break;
+            reading.Value = P1ParseFixedPoint(buffer + valueIndex + 1, 3);
+            break;
+        }
+#endif
 
-        } else if (startsWith(OBIS_CURRENT_L1, startOfLine)) {
-            data.Current[0] = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
+#if P1_PROFILES & P1_PROFILE_EMUCS
+        case OBIS_KEY(0, 96, 1, 4): // OBIS_EMUCS_VERSION
+            data.P1Version = strtoul(value, NULL, 10) / 1000; // 50217 is version 5.0.2.17
+            hasVersion = true;
+            detectedProfile = EMUCS;
+            break;
 
-        } else if (startsWith(OBIS_CURRENT_L2, startOfLine)) {
-            data.Current[1] = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
+        case OBIS_KEY(1, 1, 6, 0): // OBIS_MAX_DEMAND_MONTH
+            data.MaxDemandMonth.DateTime = P1DateTimeToSeconds(value);
+            valueIndex = indexOf('(', valueIndex + 1);
+            data.MaxDemandMonth.Value = P1ParseFixedPoint(buffer + valueIndex + 1, 3);
+            break;
 
-        } else if (startsWith(OBIS_CURRENT_L3, startOfLine)) {
-            data.Current[2] = strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
+        case OBIS_KEY(0, 98, 1, 0): { // OBIS_MAX_DEMAND_HISTORY
+            uint8_t numberOfMonths = strtoul(value, NULL, 10);
+            if (numberOfMonths > MAX_DEMAND_HISTORY_SIZE) numberOfMonths = MAX_DEMAND_HISTORY_SIZE;
+            data.NumberOfMaxDemandHistory = numberOfMonths;
 
-        } else if (startsWith(OBIS_POWER_POS_L1, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 2);
-            strncpy(&valueBuffer[2], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.PowerDelivered[0] = strtoul(valueBuffer, NULL, 10);
+            valueIndex = indexOf('(', valueIndex + 1); // Skip the two OBIS codes describing the items
+            valueIndex = indexOf('(', valueIndex + 1);
 
-        } else if (startsWith(OBIS_POWER_POS_L2, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 2);
-            strncpy(&valueBuffer[2], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.PowerDelivered[1] = strtoul(valueBuffer, NULL, 10);
+            for (uint8_t i = 0; i < numberOfMonths && valueIndex != -1; i++) {
+                valueIndex = indexOf('(', valueIndex + 1); // Start of the month
+                valueIndex = indexOf('(', valueIndex + 1);
+                data.MaxDemandHistory[i].DateTime = P1DateTimeToSeconds(buffer + valueIndex + 1);
+                valueIndex = indexOf('(', valueIndex + 1);
+                data.MaxDemandHistory[i].Value = P1ParseFixedPoint(buffer + valueIndex + 1, 3);
+            }
+            break;
+        }
+#endif
 
-        } else if (startsWith(OBIS_POWER_POS_L3, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 2);
-            strncpy(&valueBuffer[2], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.PowerDelivered[2] = strtoul(valueBuffer, NULL, 10);
+        default:
+            break;
+        }
+    }
 
-        } else if (startsWith(OBIS_POWER_POS_L1, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 2);
-            strncpy(&valueBuffer[2], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.PowerProduced[0] = strtoul(valueBuffer, NULL, 10);
+    if (decryptor != NULL) detectedProfile = Smarty;
+    data.Profile = profile == AutoDetect ? detectedProfile : profile;
 
-        } else if (startsWith(OBIS_POWER_POS_L2, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 2);
-            strncpy(&valueBuffer[2], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.PowerProduced[1] = strtoul(valueBuffer, NULL, 10);
+    // Calculate CRC
+    int16_t crcIndex = indexOf('!', 0);
+    if (crcIndex == -1) { // Cut off telegram
+        data.CRC = 0;
+        data.ValidCRC = false;
+    } else if (!hasVersion && buffer[crcIndex + 1] == '\r') {
+        // DSMR 2.2 and 3.0 telegrams end without a CRC. Complete telegrams are valid
+        data.CRC = 0;
+        data.ValidCRC = true;
+    } else {
+        uint16_t calculatedCRC = calcCRC16(buffer, crcIndex + 1);
+
+        // Check against message CRC
+        char messageCRC[5];
+        strncpy(messageCRC, buffer + crcIndex + 1, 4); // Copy message CRC
+        messageCRC[4] = 0; // 0 terminate the string
+        data.CRC = strtoul(messageCRC, NULL, 16);
+        data.ValidCRC = (data.CRC == calculatedCRC); // Convert message CRC from ascii to hex and check against calculated CRC
+    }
 
-        } else if (startsWith(OBIS_POWER_POS_L3, startOfLine)) {
-            strncpy(valueBuffer, buffer + indexOf('(', startOfLine) + 1, 2);
-            strncpy(&valueBuffer[2], buffer + indexOf('.', startOfLine + 10) + 1, 3);
-            data.PowerProduced[2] = strtoul(valueBuffer, NULL, 10);
+    // Clear buffer
+    memset(buffer, 0, BUFFER_SIZE);
+    DataReady = false;
 
-        } else if (startsWith(OBIS_DEVICE_TYPE, startOfLine + 3)) {
-            int8_t currentDeviceNumber = strtoul(&buffer[indexOf('-', startOfLine) + 1], NULL, 10);
-            data.MBusDevices[currentDeviceNumber - 1].DeviceType = (EMBusDeviceType)strtoul(&buffer[indexOf('(', startOfLine) + 1], NULL, 10);
+    lastStats.CpuMicros += micros() - startMicros;
+    return data;
+}
 
-        } else if (startsWith(OBIS_EQUIPMENT_IDENT, startOfLine + 3)) {
-            int8_t currentDeviceNumber = strtoul(&buffer[indexOf('-', startOfLine) + 1], NULL, 10);
-            data.MBusDevices[currentDeviceNumber - 1].EquipmentID = getSubString(indexOf('(', startOfLine) + 1, endOfLine -2);
+/**
+ * @brief Parses the telegram into one row of column arrays instead of a @see P1Data, e.g. to bulk parse archives for analytics.
+ * Only the numeric values are parsed, the header, hex encoded values and logs are skipped
+ * 
+ * @param batch The column arrays
+ * @param row The row to fill
+ * @return bool Whether the CRC is valid, also true for complete DSMR 2.2 and 3.0 telegrams
+ */
+bool P1Meter::ProcessTelegram(P1ColumnBatch &batch, uint32_t row) {
+    uint32_t startMicros = micros();
+    columns = &batch;
+    columnRow = row;
+    for (uint8_t i = 0; i < Column_Count; i++) {
+        if (batch.Columns[i] != NULL) batch.Columns[i][row] = 0;
+        if (batch.Valid[i] != NULL) batch.Valid[i][row / 8] &= ~(1 << (row % 8));
+    }
 
-        } else if (startsWith(OBIS_DEVICE_VALUE, startOfLine + 3)) {
-            int8_t currentDeviceNumber = strtoul(&buffer[indexOf('-', startOfLine) + 1], NULL, 10);
+    bool hasVersion = false;
+    int16_t startOfLine, endOfLine = indexOf('\n', 0);
+    while (endOfLine < bufferIndex && endOfLine != -1) {
+        startOfLine = endOfLine + 1;
+        endOfLine = indexOf('\n', startOfLine + 1);
 
-            int16_t valueIndex = indexOf('(', startOfLine);
-            strncpy(data.MBusDevices[currentDeviceNumber - 1].Reading.DateTime, buffer + valueIndex + 1, 13);
-            
+        uint8_t channel;
+        int16_t valueIndex;
+        uint32_t key = parseObis(startOfLine, channel, valueIndex);
+        if (key == 0) continue;
+        if (decodeValue(key, valueIndex, endOfLine)) continue;
+
+        // The records with more values which have a column
+        if (key == OBIS_KEY(1, 0, 2, 8)) { // OBIS_VERSION
+            setColumn(Column_Version, strtoul(buffer + valueIndex + 1, NULL, 10));
+            hasVersion = true;
+        } else if (key == OBIS_KEY(0, 24, 2, 1) && channel >= 1 && channel <= 3) { // OBIS_DEVICE_VALUE
             valueIndex = indexOf('(', valueIndex + 1);
-            strncpy(valueBuffer, buffer + valueIndex + 1, 5);
-            strncpy(&valueBuffer[5], buffer + indexOf('.', valueIndex + 1) + 1, 3);
-            data.MBusDevices[currentDeviceNumber - 1].Reading.Value = strtoul(valueBuffer, NULL, 10);
-            
-            valueIndex = indexOf('*', valueIndex + 1);
-            strncpy(data.MBusDevices[currentDeviceNumber - 1].Reading.Unit, buffer + valueIndex + 1, indexOf(')', valueIndex) - valueIndex - 1);
+            if (valueIndex != -1) setColumn(Column_MBusValue1 + channel - 1, P1ParseFixedPoint(buffer + valueIndex + 1, 3));
+        }
+#if P1_PROFILES & P1_PROFILE_LEGACY
+        else if (key == OBIS_KEY(0, 24, 3, 0) && channel >= 1 && channel <= 3) { // OBIS_LEGACY_DEVICE_VALUE, the value is on the next line
+            valueIndex = indexOf('(', endOfLine);
+            if (valueIndex != -1) setColumn(Column_MBusValue1 + channel - 1, P1ParseFixedPoint(buffer + valueIndex + 1, 3));
+        }
+#endif
+    }
+    columns = NULL;
+
+    bool valid = validTelegram(hasVersion);
+    if (batch.ValidCRC != NULL) {
+        if (valid) {
+            batch.ValidCRC[row / 8] |= 1 << (row % 8);
+        } else {
+            batch.ValidCRC[row / 8] &= ~(1 << (row % 8));
         }
     }
-
-    // Calculate CRC
-    uint16_t crcIndex = indexOf('!', 0);
-    uint16_t calculatedCRC = calcCRC16(buffer, crcIndex + 1);
-
-    // Check against message CRC
-    char messageCRC[5];
-    strncpy(messageCRC, buffer + crcIndex + 1, 4); // Copy message CRC
-    messageCRC[4] = 0; // 0 terminate the string
-    data.CRC = strtoul(messageCRC, NULL, 16);
-    data.ValidCRC = (data.CRC == calculatedCRC); // Convert message CRC from ascii to hex and check against calculated CRC
 
     // Clear buffer
     memset(buffer, 0, BUFFER_SIZE);
     DataReady = false;
 
-    return data;
+    lastStats.CpuMicros += micros() - startMicros;
+    return valid;
+}
+
+/**
+ * @brief Overrides the profile reported in P1Data::Profile, e.g. when the meter type is known. It doesn't change the parsing: every
+ * telegram is parsed by what it contains, so a DSMR 4 telegram still has its CRC checked with the profile set to DSMR_2_2
+ * 
+ * @param profile The profile to report, AutoDetect to report the detected one, @see EP1Profile
+ */
+void P1Meter::SetProfile(EP1Profile profile) {
+    this->profile = profile;
+}
+
+/**
+ * @brief Loads a telegram received in another way, e.g. over MQTT or from a file, to be parsed by @see ProcessTelegram
+ * 
+ * @param telegram The telegram from the '/' up to and including the line with the '!'
+ * @param length The number of characters
+ * @return bool False when the telegram does not fit in the buffer
+ */
+bool P1Meter::LoadTelegram(const char *telegram, uint16_t length) {
+    if (length == 0 || length >= BUFFER_SIZE) return false;
+
+    memcpy(buffer, telegram, length);
+    memset(buffer + length, 0, BUFFER_SIZE - length);
+    bufferIndex = length - 1; // Same as a received telegram, the index of the last character
+    DataReady = true;
+    return true;
+}
+
+/**
+ * @brief Clears the parsed values, so the next @see ProcessTelegram only holds the values of its own telegram. Without it values
+ * not sent by a telegram keep the value of the previous one, use it when one P1Meter parses the telegrams of several meters
+ * 
+ */
+void P1Meter::ResetData() {
+    data = P1Data();
+#if defined(P1_HEX_CACHE)
+    memset(hexCacheLength, 0xFF, sizeof(hexCacheLength)); // Nothing cached, the decoded values are gone
+#endif
 }
 
 /**
@@ -339,6 +589,248 @@ uint8_t P1Meter::endsWith(const char *findString) {
 	return strcmp(&buffer[dataLength - stringLength], findString) == 0;
 }
 
+void P1Meter::receiveEncryptedTelegram(uint8_t firstByte) {
+    // The frame is received in the telegram buffer and decrypted in place
+    uint8_t *frame = (uint8_t *)buffer;
+    uint16_t received = 0;
+    int16_t frameLength = -1;
+    if (Incomplete) { // Clear the part of the frame given up before
+        memset(buffer, 0, BUFFER_SIZE);
+        Incomplete = false;
+    }
+    frame[received++] = firstByte;
+    uint32_t lastByte = millis();
+
+    while (frameLength < 0 || received < frameLength) {
+        if (!mySerial->available()) {
+            if (millis() - lastByte > RECEIVE_TIMEOUT) { // The meter stopped sending halfway
+                bufferIndex = received - 1;
+                Incomplete = true;
+                return;
+            }
+            continue;
+        }
+
+        lastByte = millis();
+        frame[received++] = readByte();
+
+        if (frameLength < 0) {
+            frameLength = P1Decryptor::FrameLength(frame, received);
+            if (frameLength == 0 || frameLength > BUFFER_SIZE) { // Not a frame or it won't fit
+                memset(buffer, 0, BUFFER_SIZE);
+                return;
+            }
+        }
+    }
+
+    int16_t telegramLength = decryptor->Decrypt(frame, frameLength);
+    if (telegramLength <= 0) { // Corrupt frame or wrong keys
+        memset(buffer, 0, BUFFER_SIZE);
+        return;
+    }
+    memset(buffer + telegramLength, 0, BUFFER_SIZE - telegramLength);
+
+    bufferIndex = telegramLength - 1; // Same as a plain telegram, the index of the last received character
+    DataReady = true;
+    releaseRequest();
+}
+
+void P1Meter::releaseRequest() {
+    if (ctsPin != 0xFF) {
+        // Setting CTS low is against the P1 standard. It should be set to high impedance / pinmode input could do it
+        pinMode(ctsPin, INPUT); // Pause the telegram sending to be sure it won't mess up de rx buffer
+        ctsHigh = false;
+    }
+}
+
+bool P1Meter::startReading() {
+    uint32_t elapsed = millis() - readingStart;
+    if (!readingDue && elapsed < readInterval) {
+        // Drop what the meter sends without a request, e.g. when the request line is not connected
+        while (mySerial->available()) readByte();
+
+        if (sleepCallback != NULL) {
+            uint32_t sleepStart = millis();
+            sleepCallback(readInterval - elapsed);
+            currentStats.SleepMillis += millis() - sleepStart;
+        }
+        return false;
+    }
+
+    readingDue = false;
+    reading = true;
+    readingStart = millis();
+    return true;
+}
+
+void P1Meter::finishReading() {
+    uint32_t now = millis();
+    uint32_t period = now - lastReadingEnd;
+    if (period < currentStats.SleepMillis) period = currentStats.SleepMillis;
+
+    currentStats.AwakeMillis = now - readingStart;
+    // uA * ms / 3600 is nAh
+    currentStats.Charge = ((uint64_t)activeCurrent * (period - currentStats.SleepMillis) + (uint64_t)sleepCurrent * currentStats.SleepMillis) / 3600;
+
+    lastStats = currentStats;
+    memset(&currentStats, 0, sizeof(currentStats));
+    lastReadingEnd = now;
+    reading = false;
+}
+
+bool P1Meter::validTelegram(bool hasVersion) {
+    int16_t crcIndex = indexOf('!', 0);
+    if (crcIndex == -1) return false;
+    if (!hasVersion && buffer[crcIndex + 1] == '\r') return true; // DSMR 2.2 and 3.0 have no CRC
+
+    return strtoul(buffer + crcIndex + 1, NULL, 16) == calcCRC16(buffer, crcIndex + 1);
+}
+
+uint8_t P1Meter::readByte() {
+    uint8_t value = mySerial->read();
+    if (recorder == NULL) return value;
+
+    uint32_t now = micros();
+    uint32_t delta = now - lastRecordMicros;
+    lastRecordMicros = now;
+
+    uint8_t record[6];
+    uint8_t length = 0;
+    while (delta >= 0x80) {
+        record[length++] = (delta & 0x7F) | 0x80;
+        delta >>= 7;
+    }
+    record[length++] = delta;
+    record[length++] = value;
+    recorder->write(record, length);
+    return value;
+}
+
+uint32_t P1Meter::parseObis(int16_t startOfLine, uint8_t &channel, int16_t &valueIndex) {
+    // A-B:C.D.E( in a single pass, B is returned as the channel
+    uint8_t fields[5] = { 0, 0, 0, 0, 0 };
+    static const char separators[5] = { '-', ':', '.', '.', '(' };
+
+    const char *position = buffer + startOfLine;
+    for (uint8_t field = 0; field < 5; field++) {
+        uint8_t digits = 0;
+        while ((uint8_t)(*position - '0') <= 9) {
+            fields[field] = fields[field] * 10 + (*position - '0');
+            position++;
+            digits++;
+        }
+        if (digits == 0 || digits > 3 || *position != separators[field]) return 0;
+        position++;
+    }
+
+    channel = fields[1];
+    valueIndex = position - buffer - 1;
+    return OBIS_KEY(fields[0], fields[2], fields[3], fields[4]);
+}
+
+bool P1Meter::decodeValue(uint32_t key, int16_t valueIndex, int16_t endOfLine) {
+    // Binary search for the first decoder with a key not below the line key
+    uint8_t low = 0, high = VALUE_DECODER_COUNT;
+    while (low < high) {
+        uint8_t middle = (low + high) / 2;
+        if (pgm_read_dword(&valueDecoders[middle].Key) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == VALUE_DECODER_COUNT || pgm_read_dword(&valueDecoders[low].Key) != key) return false;
+
+    uint8_t *field = (uint8_t *)&data + pgm_read_word(&valueDecoders[low].Offset);
+    uint32_t *column = NULL;
+    if (columns != NULL) { // Only the numeric values, straight into their column
+        uint8_t index = pgm_read_byte(&valueDecoders[low].Column);
+        if (index == Column_None || columns->Columns[index] == NULL) return true;
+        column = columns->Columns[index] + columnRow;
+        if (columns->Valid[index] != NULL) columns->Valid[index][columnRow / 8] |= 1 << (columnRow % 8);
+    }
+
+    const char *value = buffer + valueIndex + 1;
+    uint8_t kind = pgm_read_byte(&valueDecoders[low].Kind);
+    switch (kind & 0x0F) {
+    case FixedPointValue: {
+        int8_t decimals = pgm_read_byte(&valueDecoders[low].Decimals);
+        EP1Unit fieldUnit = (EP1Unit)(kind >> 4);
+        if (fieldUnit != Unit_None) {
+            // Another unit of the same quantity, e.g. W instead of kW, is normalised by parsing more or less decimals
+            EP1Unit unit = parseUnit(indexOf('*', valueIndex), endOfLine);
+            if (unit != fieldUnit && P1SameQuantity(unit, fieldUnit)) {
+                decimals += P1UnitScale(unit) - P1UnitScale(fieldUnit);
+            }
+        }
+
+        uint32_t result = P1ParseFixedPoint(value, decimals < 0 ? 0 : decimals);
+        for (; decimals < 0; decimals++) result /= 10;
+        *(column != NULL ? column : (uint32_t *)field) = result;
+        break;
+    }
+    case ByteValue:
+        if (column != NULL) {
+            *column = P1ParseFixedPoint(value, 0);
+        } else {
+            *field = P1ParseFixedPoint(value, 0);
+        }
+        break;
+    case DateTimeValue:
+        if (column != NULL) {
+            *column = P1DateTimeToSeconds(value);
+        } else {
+            strncpy((char *)field, value, 13);
+        }
+        break;
+    case HexValue: {
+        uint8_t slot = pgm_read_byte(&valueDecoders[low].Decimals);
+        decodeHexValue(slot, valueIndex, endOfLine, (char *)field, slot == HEX_SLOT_TEXT_MESSAGE ? P1_TEXT_MESSAGE_SIZE : P1_EQUIPMENT_ID_SIZE);
+        break;
+    }
+    }
+    return true;
+}
+
+void P1Meter::setColumn(uint8_t column, uint32_t value) {
+    if (columns->Columns[column] == NULL) return;
+    columns->Columns[column][columnRow] = value;
+    if (columns->Valid[column] != NULL) columns->Valid[column][columnRow / 8] |= 1 << (columnRow % 8);
+}
+
+void P1Meter::decodeHexValue(uint8_t slot, int16_t valueIndex, int16_t endOfLine, char *output, uint16_t size) {
+    const char *hex = buffer + valueIndex + 1;
+    const char *end = (const char *)memchr(hex, ')', endOfLine - valueIndex - 1);
+    uint16_t length = end == NULL ? 0 : end - hex;
+
+#if defined(P1_HEX_CACHE)
+    // The cached hex of the previous telegram, each slot holds twice the decoded size
+    uint16_t capacity = 2 * ((slot == HEX_SLOT_TEXT_MESSAGE ? P1_TEXT_MESSAGE_SIZE : P1_EQUIPMENT_ID_SIZE) - 1);
+    uint16_t offset = slot == HEX_SLOT_EQUIPMENT_ID ? 0 : 2 * (P1_EQUIPMENT_ID_SIZE - 1);
+    if (slot >= HEX_SLOT_MBUS) offset += 2 * (P1_TEXT_MESSAGE_SIZE - 1) + (slot - HEX_SLOT_MBUS) * capacity;
+    char *cached = hexCache + offset;
+
+    if (length == hexCacheLength[slot] && memcmp(hex, cached, length) == 0) return; // Unchanged, output still holds the decoded value
+
+    if (length <= capacity) {
+        memcpy(cached, hex, length);
+        hexCacheLength[slot] = length;
+    } else {
+        hexCacheLength[slot] = 0xFFFF; // Too long to cache
+    }
+#else
+    (void)slot;
+#endif
+
+    P1DecodeHex(hex, length, output, size);
+}
+
+EP1Unit P1Meter::parseUnit(int16_t index, int16_t endOfLine) {
+    // From the * or ( before the unit
+    if (index == -1 || index >= endOfLine) return Unit_None;
+    return P1ParseUnit(buffer + index + 1);
+}
+
 String P1Meter::getSubString(uint16_t startIndex, uint16_t endIndex) {
   String output;
   char temp = buffer[endIndex];
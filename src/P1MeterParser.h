@@ -14,6 +14,10 @@
 #define P1METER_H
 
 #include <Arduino.h>
+#include "P1Decryptor.h"
+#include "P1DateTime.h"
+#include "P1Hex.h"
+#include "P1Unit.h"
 
 // OBIS codes for the master device
 #define OBIS_VERSION            "1-3:0.2.8" // Version information for P1 output
@@ -50,10 +54,27 @@
 #define OBIS_POWER_NEG_L2       "1-0:42.7.0" // Instantaneous active power L2 (-P) in W resolution
 #define OBIS_POWER_NEG_L3       "1-0:62.7.0" // Instantaneous active power L3 (-P) in W resolution
 
+// OBIS codes for the Belgian capacity tariff (e-MUCS)
+#define OBIS_EMUCS_VERSION      "0-0:96.1.4"// Version information of the e-MUCS specification, e.g. 50217 for 5.0.2.17
+#define OBIS_AVERAGE_DEMAND     "1-0:1.4.0" // Current average demand of the running quarter hour in kW
+#define OBIS_MAX_DEMAND_MONTH   "1-0:1.6.0" // Maximum quarter hour demand of the running month. Consists of a timestamp and value
+#define OBIS_MAX_DEMAND_HISTORY "0-0:98.1.0"// Maximum demand of the last 13 months. Each item consists of the month start, the peak timestamp and value
+
 // OBIS codes sub devices
 #define OBIS_DEVICE_TYPE        ":24.1.0" // Device-Type
 #define OBIS_EQUIPMENT_IDENT    ":96.1.0" // Equipment identifier (Thermal:  Heat or Cold) (Water) (Gas)
 #define OBIS_DEVICE_VALUE       ":24.2.1" // Last 5-minute Meter value. Consists of a timestamp and value
+#define OBIS_LEGACY_DEVICE_VALUE ":24.3.0"// Last hourly Meter value of DSMR 2.2 and 3.0. Consists of a timestamp, settings, unit and the value on the next line
+
+// Packed OBIS code A-B:C.D.E without the B (channel) field, used to dispatch the lines
+#define OBIS_KEY(a, c, d, e) (((uint32_t)(a) << 24) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 8) | (uint32_t)(e))
+
+// Profiles compiled in besides DSMR 4 and 5. Define P1_PROFILES as a subset to leave out the code of unused profiles
+#define P1_PROFILE_LEGACY       0x01 // DSMR 2.2 and 3.0
+#define P1_PROFILE_EMUCS        0x02 // Belgian e-MUCS
+#ifndef P1_PROFILES
+#define P1_PROFILES             (P1_PROFILE_LEGACY | P1_PROFILE_EMUCS)
+#endif
 
 // OBIS device types
 #define OBIS_DEV_TYPE_GAS       3 // Gas meter
@@ -64,6 +85,47 @@
 // Max data as specified in the P1 5.0.2 standard chapter 6.2 states it can contain up to 1024 characters
 #define BUFFER_SIZE 1024
 
+// Milliseconds a duty cycled reading waits for a valid telegram, long enough for DSMR 4 and older meters sending every 10 seconds
+#ifndef READING_TIMEOUT
+#define READING_TIMEOUT 12000
+#endif
+
+// Milliseconds without a byte after which a telegram is given up, e.g. when the cable was pulled or a recording ended
+#ifndef RECEIVE_TIMEOUT
+#define RECEIVE_TIMEOUT 500
+#endif
+
+#define MAX_DEMAND_HISTORY_SIZE 13 // Number of months in the e-MUCS maximum demand history
+
+// Sizes of the decoded hex values including the terminator. Longer values are cut off
+#define P1_EQUIPMENT_ID_SIZE 49 // At most 96 hex characters
+#ifndef P1_TEXT_MESSAGE_SIZE
+#if defined(__AVR__)
+#define P1_TEXT_MESSAGE_SIZE 33
+#else
+#define P1_TEXT_MESSAGE_SIZE 257
+#endif
+#endif
+
+// Keep the hex values of the previous telegram to skip decoding when they did not change. Costs twice the decoded sizes in RAM
+#if !defined(__AVR__) && !defined(P1_NO_HEX_CACHE)
+#define P1_HEX_CACHE
+#endif
+#define HEX_CACHE_SLOTS 5 // Equipment ID, text message and 3 M-Bus equipment IDs
+
+/**
+ * @brief Protocol variants as reported in P1Data::Profile. DSMR 2.2 and 3.0 use 9600 baud 7E1, have no CRC and send the gas reading
+ * over two lines. The others use 115200 baud 8N1
+ */
+enum EP1Profile {
+    AutoDetect = 0, // Detect from the version line of every telegram
+    DSMR_2_2 = 1,   // No version line, DSMR 2.2 and 3.0 can't be told apart and are parsed the same
+    DSMR_4 = 3,     // 1-3:0.2.8 version 40 or 42. 2 was DSMR 3.0, which was never reported
+    DSMR_5 = 4,     // 1-3:0.2.8 version 50
+    EMUCS = 5,      // Belgian e-MUCS, 0-0:96.1.4 version line
+    Smarty = 6      // Luxembourg, detected when a decryption key is set
+};
+
 enum EMBusDeviceType {
     Gas = OBIS_DEV_TYPE_GAS,
     Thermal = OBIS_DEV_TYPE_THERMAL,
@@ -75,15 +137,20 @@ struct PowerFailureLogStruct {
     double Duration;
 };
 
+struct MaxDemandStruct {
+    uint32_t DateTime; // Timestamp of the peak in seconds since 2000-01-01, see P1DateTimeToSeconds
+    uint32_t Value; // Quarter hour average in watts
+};
+
 struct MBusReading {
     char DateTime[14];
     uint32_t Value;
-    char Unit[4];
+    EP1Unit Unit; // Value is in thousandths of this unit
 };
 
 struct MBusDevice {
     EMBusDeviceType DeviceType;
-    String EquipmentID;
+    char EquipmentID[P1_EQUIPMENT_ID_SIZE]; // Decoded from hex
     MBusReading Reading;
 };
 
@@ -95,7 +162,7 @@ struct P1Data {
     String HeaderInfo;
     byte P1Version;
     char DateTime[14]; // YYMMDDhhmmssX where x is S or W for summer and winter time
-    String EquipmentID;
+    char EquipmentID[P1_EQUIPMENT_ID_SIZE]; // Decoded from hex
     uint32_t DeliveredTariff1; // Low tariff in watts
     uint32_t DeliveredTariff2; // High tariff in watts
     uint32_t ProducedTariff1; // Low tariff in watts
@@ -108,15 +175,92 @@ struct P1Data {
     PowerFailureLogStruct PowerFailureLogs[3]; // TODO: find out needed buffer size
     uint32_t VoltageSags[3]; // Voltage sag buffer for all 3 phases L1 L2 L3
     uint32_t VoltageSwells[3]; // Voltage swell buffer for all 3 phases L1 L2 L3
-    String TextMessage;
+    char TextMessage[P1_TEXT_MESSAGE_SIZE]; // Decoded from hex
     uint32_t Voltage[3]; // Voltage buffer for all 3 phases in 100mV
     uint32_t Current[3]; // Current buffer for all 3 phases in A
     uint32_t PowerDelivered[3]; // +P Power buffer for all 3 phases in watts
     uint32_t PowerProduced[3]; // -P Power buffer for all 3 phases in watts
     MBusDevice MBusDevices[3]; // TODO: find out needed buffer size. Expecting a GAS, WATER and another electric meter should be enoug?
+    uint32_t AverageDemand; // Average demand of the running quarter hour in watts (e-MUCS)
+    MaxDemandStruct MaxDemandMonth; // Peak quarter hour demand of the running month (e-MUCS)
+    MaxDemandStruct MaxDemandHistory[MAX_DEMAND_HISTORY_SIZE]; // Peak demand of the previous months, most recent first (e-MUCS)
+    byte NumberOfMaxDemandHistory;
     uint16_t CRC;
-    bool ValidCRC;
+    bool ValidCRC; // Also true for complete DSMR 2.2 and 3.0 telegrams, which have no CRC
     byte NumberOfMBusDevices;
+    EP1Profile Profile; // The detected or configured protocol profile
+};
+
+/**
+ * @brief Columns of @see P1ColumnBatch, in the unit of the matching P1Data field
+ * 
+ */
+enum EP1Column {
+    Column_DateTime, // Seconds since 2000-01-01, see P1DateTimeToSeconds
+    Column_DeliveredTariff1,
+    Column_DeliveredTariff2,
+    Column_ProducedTariff1,
+    Column_ProducedTariff2,
+    Column_CurrentTariff,
+    Column_ActualDelivered,
+    Column_ActualProduced,
+    Column_PowerFailures,
+    Column_LongPowerFailures,
+    Column_VoltageSagsL1,
+    Column_VoltageSagsL2,
+    Column_VoltageSagsL3,
+    Column_VoltageSwellsL1,
+    Column_VoltageSwellsL2,
+    Column_VoltageSwellsL3,
+    Column_VoltageL1,
+    Column_VoltageL2,
+    Column_VoltageL3,
+    Column_CurrentL1,
+    Column_CurrentL2,
+    Column_CurrentL3,
+    Column_PowerDeliveredL1,
+    Column_PowerDeliveredL2,
+    Column_PowerDeliveredL3,
+    Column_PowerProducedL1,
+    Column_PowerProducedL2,
+    Column_PowerProducedL3,
+    Column_AverageDemand,
+    Column_Version,
+    Column_MBusValue1, // Reading of the M-Bus device on channel 1 in thousandths of its unit
+    Column_MBusValue2,
+    Column_MBusValue3,
+    Column_Count,
+    Column_None = 0xFF // Values without a column, e.g. the hex encoded ones
+};
+
+/**
+ * @brief Column arrays for parsing many telegrams, one row per telegram. Only the numeric values are stored, straight from the telegram
+ * @note The bitmaps hold row r in bit r % 8 of byte r / 8
+ * 
+ */
+struct P1ColumnBatch {
+    uint32_t *Columns[Column_Count]; // NULL for the columns which are not needed. Rows without the value are 0
+    uint8_t *Valid[Column_Count]; // Bitmap of the rows with the value, may be NULL
+    uint8_t *ValidCRC; // Bitmap of the rows with a valid CRC, may be NULL
+};
+
+/**
+ * @brief Called by @see P1Meter::ReceiveTelegram in duty cycled mode when no reading is due. Put the MCU to sleep for at most
+ * the given time, with wake up on UART activity if the board supports it
+ */
+typedef void (*P1SleepCallback)(uint32_t milliseconds);
+
+/**
+ * @brief Cost of the last reading in duty cycled mode, @see P1Meter::SetReadInterval
+ * 
+ */
+struct P1ReadingStats {
+    uint32_t AwakeMillis; // From raising the request line up to the valid telegram or the timeout
+    uint32_t SleepMillis; // Time spent in the sleep callback since the previous reading
+    uint32_t CpuMicros; // Time spent in ReceiveTelegram and ProcessTelegram
+    uint8_t Telegrams; // Telegrams received for this reading, more than 1 when telegrams were corrupt
+    uint32_t Charge; // Estimated charge used since the previous reading in nAh, @see P1Meter::SetSupplyCurrent
+    bool TimedOut; // No valid telegram within the reading timeout, the reading failed
 };
 
 /**
@@ -125,22 +269,47 @@ struct P1Data {
  */
 class P1Meter {
 public:
-    P1Meter(HardwareSerial *serial);
-    P1Meter(HardwareSerial *serial, uint8_t ctsPin);
+    P1Meter(Stream *serial);
+    P1Meter(Stream *serial, uint8_t ctsPin);
+    ~P1Meter();
+    P1Meter(const P1Meter &) = delete; // Owns the buffer and the decryptor
+    P1Meter &operator=(const P1Meter &) = delete;
 
     /**
      * Basic functions
      */
     void ReceiveTelegram();
     P1Data ProcessTelegram();
+    bool ProcessTelegram(P1ColumnBatch &batch, uint32_t row);
+    void SetProfile(EP1Profile profile);
+
+    /**
+     * Duty cycled reception for battery powered nodes
+     */
+    void SetReadInterval(uint32_t intervalMillis, P1SleepCallback sleepCallback = NULL, uint32_t timeoutMillis = READING_TIMEOUT);
+    void SetSupplyCurrent(uint32_t activeMicroamps, uint32_t sleepMicroamps);
+    P1ReadingStats GetReadingStats();
+
+    /**
+     * Encrypted telegrams (Luxembourg Smarty, Austria)
+     */
+    void SetDecryptionKey(const uint8_t *encryptionKey, const uint8_t *authenticationKey = NULL);
+
+    /**
+     * Capture of the raw received bytes, see P1Replayer to play them back
+     */
+    void SetRecorder(Print *recorder);
 
     /**
      * Low level functions
      */
+    bool LoadTelegram(const char *telegram, uint16_t length);
+    void ResetData();
     char *GetBuffer();
     int16_t GetBufferLength();
 
     bool DataReady = false;
+    bool Incomplete = false; // The last telegram was given up before its end, @see GetBuffer holds the received part
 
 protected:
 
@@ -151,15 +320,50 @@ private:
     uint8_t startsWith(const char *findString, uint16_t offset);
     uint8_t endsWith(const char *findString);
     String getSubString(uint16_t startIndex, uint16_t endIndex);
+    void receive();
+    void receiveEncryptedTelegram(uint8_t firstByte);
+    void releaseRequest();
+    bool startReading();
+    void finishReading();
+    bool validTelegram(bool hasVersion = false);
+    uint32_t parseObis(int16_t startOfLine, uint8_t &channel, int16_t &valueIndex);
+    bool decodeValue(uint32_t key, int16_t valueIndex, int16_t endOfLine);
+    void setColumn(uint8_t column, uint32_t value);
+    void decodeHexValue(uint8_t slot, int16_t valueIndex, int16_t endOfLine, char *output, uint16_t size);
+    EP1Unit parseUnit(int16_t index, int16_t endOfLine);
+    uint8_t readByte();
 
-    HardwareSerial *mySerial;
+    Stream *mySerial;
+    Print *recorder = NULL;
+    uint32_t lastRecordMicros = 0;
 
-    char *buffer;
+    char *buffer = NULL;
     int16_t bufferIndex = 0;
-    P1Data data;
+    P1Data data = P1Data(); // Zeroed, the fields a telegram doesn't send stay 0
+    P1ColumnBatch *columns = NULL; // Set while parsing into columns
+    uint32_t columnRow = 0;
+#if defined(P1_HEX_CACHE)
+    char hexCache[2 * (4 * (P1_EQUIPMENT_ID_SIZE - 1) + P1_TEXT_MESSAGE_SIZE - 1)];
+    uint16_t hexCacheLength[HEX_CACHE_SLOTS] = { 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF }; // Nothing cached
+#endif
+
+    P1Decryptor *decryptor = NULL;
+    EP1Profile profile = AutoDetect;
 
     uint8_t ctsPin = 0xFF;
     bool ctsHigh = false;
+
+    uint32_t readInterval = 0; // 0 when not duty cycled
+    uint32_t readTimeout = 0; // 0 waits for a valid telegram forever
+    P1SleepCallback sleepCallback = NULL;
+    bool reading = false; // A reading is in progress
+    bool readingDue = true;
+    uint32_t readingStart = 0;
+    uint32_t lastReadingEnd = 0;
+    uint32_t activeCurrent = 0; // In uA
+    uint32_t sleepCurrent = 0;
+    P1ReadingStats currentStats = {};
+    P1ReadingStats lastStats = {};
 };
 
 #endif // P1METER_H
\ No newline at end of file
@@ -0,0 +1,61 @@
+/**
+ * @file P1PhaseAnalytics.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Per phase net power, imbalance and headroom against the fuse size, e.g. for EV charger load balancing
+ * @version 0.1
+ * @date 2022-03-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1PhaseAnalytics.h"
+
+/**
+ * @brief Construct a new phase analytics stage
+ *
+ * @param fuseSize The main fuse size per phase in A
+ * @param numberOfPhases The number of phases of the connection, 1 or 3
+ */
+P1PhaseAnalytics::P1PhaseAnalytics(uint16_t fuseSize, uint8_t numberOfPhases) {
+    fuseCurrent = (uint32_t)fuseSize * 1000;
+    this->numberOfPhases = numberOfPhases < 1 ? 1 : numberOfPhases > 3 ? 3 : numberOfPhases;
+}
+
+/**
+ * @brief Updates the metrics with a new telegram
+ *
+ * @param data The parsed telegram
+ */
+void P1PhaseAnalytics::Update(const P1Data &data) {
+    uint32_t lowest = 0xFFFFFFFFUL, highest = 0, total = 0;
+    AvailableCurrent = 0x7FFFFFFFL;
+
+    for (uint8_t phase = 0; phase < numberOfPhases; phase++) {
+        NetPower[phase] = (int32_t)data.PowerDelivered[phase] - (int32_t)data.PowerProduced[phase];
+
+        // W / V = A, with the voltage in 100 mV: W * 10000 / voltage = mA
+        uint32_t voltage = data.Voltage[phase] != 0 ? data.Voltage[phase] : NOMINAL_VOLTAGE;
+        uint32_t power = NetPower[phase] < 0 ? -NetPower[phase] : NetPower[phase];
+        uint32_t current = (uint32_t)((uint64_t)power * 10000 / voltage);
+        if (data.Current[phase] * 1000 > current + 999) { // Reported current is truncated to whole amperes
+            current = data.Current[phase] * 1000;
+        }
+        PhaseCurrent[phase] = current;
+        NetCurrent[phase] = NetPower[phase] < 0 ? -(int32_t)current : (int32_t)current;
+
+        // Produced current makes room for more load, and the other way around
+        Headroom[phase] = (int32_t)fuseCurrent - NetCurrent[phase];
+        ExportHeadroom[phase] = (int32_t)fuseCurrent + NetCurrent[phase];
+        HeadroomPower[phase] = (int32_t)((int64_t)Headroom[phase] * (int32_t)voltage / 10000);
+        if (Headroom[phase] < AvailableCurrent) AvailableCurrent = Headroom[phase];
+
+        if (current < lowest) lowest = current;
+        if (current > highest) highest = current;
+        total += current;
+    }
+
+    uint32_t average = total / numberOfPhases;
+    uint32_t imbalance = average == 0 ? 0 : (uint32_t)((uint64_t)(highest - lowest) * 1000 / average);
+    Imbalance = imbalance > 0xFFFF ? 0xFFFF : imbalance;
+}
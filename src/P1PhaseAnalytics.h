@@ -0,0 +1,48 @@
+/**
+ * @file P1PhaseAnalytics.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Per phase net power, imbalance and headroom against the fuse size, e.g. for EV charger load balancing
+ * @version 0.1
+ * @date 2022-03-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The meter reports the current in whole amperes only. The phase currents are derived from the power and voltage in mA instead,
+ * falling back to the reported current when it is higher (reactive loads)
+ */
+
+#ifndef P1PHASEANALYTICS_H
+#define P1PHASEANALYTICS_H
+
+#include <Arduino.h>
+#include "P1MeterParser.h"
+
+#define NOMINAL_VOLTAGE 2300 // 230 V in 100 mV, used when the meter doesn't report the voltage
+
+/**
+ * @brief Derives the per phase metrics of a telegram. Run it after every @see P1Meter::ProcessTelegram
+ *
+ */
+class P1PhaseAnalytics {
+public:
+    P1PhaseAnalytics(uint16_t fuseSize, uint8_t numberOfPhases = 3);
+
+    void Update(const P1Data &data);
+
+    int32_t NetPower[3] = {}; // Delivered minus produced power per phase in watts
+    uint32_t PhaseCurrent[3] = {}; // Current per phase in mA
+    int32_t NetCurrent[3] = {}; // Current per phase in mA, negative when producing
+    int32_t Headroom[3] = {}; // Load that can be added per phase before the fuse size is reached in mA, negative when overloaded.
+                              // Includes the produced current, e.g. 38 A when producing 13 A on a 25 A fuse
+    int32_t HeadroomPower[3] = {}; // Headroom per phase in watts
+    int32_t ExportHeadroom[3] = {}; // Production that can be added per phase before the fuse size is reached in mA, negative when
+                                    // the production overloads it
+    int32_t AvailableCurrent = 0; // Lowest headroom of all phases in mA, the limit for a multi phase load
+    uint16_t Imbalance = 0; // Difference between the highest and lowest phase current relative to the average in permille
+
+private:
+    uint32_t fuseCurrent; // In mA
+    uint8_t numberOfPhases;
+};
+
+#endif // P1PHASEANALYTICS_H
@@ -0,0 +1,30 @@
+/**
+ * @file P1Register.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Increase of the cumulative registers and counters of the meter between two telegrams
+ * @version 0.1
+ * @date 2022-06-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef P1REGISTER_H
+#define P1REGISTER_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Gets the increase of a register, e.g. the energy delivered or the number of voltage sags, since a previous reading
+ * @note The registers only ever increase. A value lower than before means the meter was reset or replaced, so the register
+ * counted up from zero since
+ *
+ * @param current The register now
+ * @param previous The register at the previous reading
+ * @return uint32_t The increase
+ */
+inline uint32_t P1RegisterDelta(uint32_t current, uint32_t previous) {
+    return current >= previous ? current - previous : current;
+}
+
+#endif // P1REGISTER_H
@@ -0,0 +1,102 @@
+/**
+ * @file P1Replayer.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Plays back a recording made with P1Meter::SetRecorder as a serial stream
+ * @version 0.1
+ * @date 2022-03-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1Replayer.h"
+
+/**
+ * @brief Construct a new replayer
+ *
+ * @param recording The recording, e.g. a File on an SD card
+ * @param originalTiming True to replay at the recorded timing, false to replay as fast as possible
+ */
+P1Replayer::P1Replayer(Stream *recording, bool originalTiming) {
+    this->recording = recording;
+    this->originalTiming = originalTiming;
+
+    for (uint8_t i = 0; i < REPLAY_MAGIC_LENGTH; i++) {
+        if (recording->read() != (uint8_t)REPLAY_MAGIC[i]) {
+            finished = true; // Not a recording
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Gets the number of bytes available. With the original timing this is 1 once the next byte is due and 0 before
+ *
+ * @return int Number of available bytes
+ */
+int P1Replayer::available() {
+    if (!hasNext && !loadNext()) return 0;
+
+    if (!started) { // The time starts with the first request for data
+        started = true;
+        startMicros = micros() - nextDue;
+    }
+
+    if (originalTiming && (int32_t)(micros() - startMicros - nextDue) < 0) return 0;
+    return 1;
+}
+
+int P1Replayer::read() {
+    if (available() == 0) return -1;
+    hasNext = false;
+    return nextByte;
+}
+
+int P1Replayer::peek() {
+    if (available() == 0) return -1;
+    return nextByte;
+}
+
+size_t P1Replayer::write(uint8_t value) {
+    (void)value;
+    return 0; // The meter side is read only
+}
+
+/**
+ * @brief Checks if the whole recording has been played
+ *
+ * @return true When all bytes have been read
+ */
+bool P1Replayer::Finished() {
+    return finished && !hasNext;
+}
+
+
+/***************** Helper functions *****************/
+
+bool P1Replayer::loadNext() {
+    if (finished) return false;
+
+    uint32_t delta = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        int value = recording->read();
+        if (value < 0) {
+            finished = true;
+            return false;
+        }
+
+        delta |= (uint32_t)(value & 0x7F) << shift;
+        if ((value & 0x80) == 0) break;
+    }
+
+    int value = recording->read();
+    if (value < 0) {
+        finished = true;
+        return false;
+    }
+
+    nextByte = value;
+    nextDue += delta;
+    hasNext = true;
+    return true;
+}
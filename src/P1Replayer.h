@@ -0,0 +1,51 @@
+/**
+ * @file P1Replayer.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Plays back a recording made with P1Meter::SetRecorder as a serial stream
+ * @version 0.1
+ * @date 2022-03-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note Pass the replayer to the P1Meter constructor instead of the serial port. With the original timing the bytes become available
+ * at the same intervals as they were received, which reproduces stalls and bursts. Without it the recording is read as fast as possible
+ */
+
+#ifndef P1REPLAYER_H
+#define P1REPLAYER_H
+
+#include <Arduino.h>
+
+#define REPLAY_MAGIC        "P1R\x01" // Start of a recording, including the format version
+#define REPLAY_MAGIC_LENGTH 4
+
+/**
+ * @brief Stream returning the recorded bytes
+ *
+ */
+class P1Replayer : public Stream {
+public:
+    P1Replayer(Stream *recording, bool originalTiming = true);
+
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t value);
+
+    bool Finished();
+
+private:
+    bool loadNext();
+
+    Stream *recording;
+    bool originalTiming;
+
+    bool hasNext = false;
+    bool finished = false;
+    bool started = false;
+    uint8_t nextByte = 0;
+    uint32_t nextDue = 0; // Offset of the next byte from the start of the replay in microseconds
+    uint32_t startMicros = 0;
+};
+
+#endif // P1REPLAYER_H
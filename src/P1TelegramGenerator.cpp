@@ -0,0 +1,310 @@
+/**
+ * @file P1TelegramGenerator.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Generates realistic, CRC valid P1 telegrams for testing without a meter
+ * @version 0.1
+ * @date 2022-03-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1TelegramGenerator.h"
+#include "P1MeterParser.h"
+#include "CRC16.h"
+
+static const char hexDigits[] = "0123456789ABCDEF";
+static const char *equipmentId = "4530303331303033303031363939353135"; // E0031003001699515
+static const char *gasEquipmentId = "4730303332353631323831363736313131"; // G0032561281676111
+
+/**
+ * @brief Construct a new telegram generator
+ *
+ * @param config The layout of the telegrams
+ */
+P1TelegramGenerator::P1TelegramGenerator(const P1GeneratorConfig &config) {
+    this->config = config;
+    if (this->config.NumberOfPhases != 1) this->config.NumberOfPhases = 3;
+    if (this->config.NumberOfMBusDevices > 4) this->config.NumberOfMBusDevices = 4;
+    if (this->config.NumberOfPowerFailureLogs > GENERATOR_MAX_POWER_LOGS) this->config.NumberOfPowerFailureLogs = GENERATOR_MAX_POWER_LOGS;
+
+    textMessage[0] = 0;
+    if (config.TextMessage != NULL) {
+        strncpy(textMessage, config.TextMessage, GENERATOR_MAX_TEXT_MESSAGE);
+        textMessage[GENERATOR_MAX_TEXT_MESSAGE] = 0;
+    }
+
+    seconds = config.Start;
+    interval = config.Version >= 50 ? 1 : 10;
+    randomState = config.Seed != 0 ? config.Seed : 1;
+
+    registers[0] = 12345678; // Start with realistic readings
+    registers[1] = 9876543;
+    registers[2] = config.Production ? 2345678 : 0;
+    registers[3] = config.Production ? 3456789 : 0;
+    gas = 4567890;
+
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        power[phase] = 300 + 100 * phase;
+        voltage[phase] = 2300;
+    }
+}
+
+/**
+ * @brief Generates the next telegram. Every call advances the time by the telegram interval of the DSMR version
+ *
+ * @param output Buffer for the telegram
+ * @param size Size of the buffer. The telegram is not 0 terminated
+ * @return uint16_t The telegram length or 0 when it didn't fit
+ */
+uint16_t P1TelegramGenerator::Next(char *output, uint16_t size) {
+    bool legacy = config.Version < 40;
+    out = output;
+    end = output + size;
+    overflow = false;
+
+    uint32_t delivered = 0, produced = 0;
+    for (uint8_t phase = 0; phase < config.NumberOfPhases; phase++) {
+        if (power[phase] > 0) delivered += power[phase];
+        else produced -= power[phase];
+    }
+
+    // Header
+    writeString(config.Version >= 50 ? "/ISK5\\2M550T-1012\r\n\r\n" : (legacy ? "/ISk5\\2ME382-1003\r\n\r\n" : "/KFM5KAIFA-METER\r\n\r\n"));
+    if (!legacy) {
+        writeString(OBIS_VERSION "(");
+        writeNumber(config.Version, 2);
+        writeString(")\r\n" OBIS_DATETIME "(");
+        writeDateTime(seconds);
+        writeString(")\r\n");
+    }
+    writeString(OBIS_EQUIPMENTID "(");
+    writeString(equipmentId);
+    writeString(")\r\n");
+
+    // Registers, DSMR 2.2 and 3.0 use one integer digit less and kW with 2 decimals for the power
+    uint8_t registerDigits = legacy ? 5 : 6;
+    writeLine(OBIS_TARIFF1_DELIVERED, registers[0], registerDigits, 3, "kWh");
+    writeLine(OBIS_TARIFF2_DELIVERED, registers[1], registerDigits, 3, "kWh");
+    writeLine(OBIS_TARIFF1_PRODUCED, registers[2], registerDigits, 3, "kWh");
+    writeLine(OBIS_TARIFF2_PRODUCED, registers[3], registerDigits, 3, "kWh");
+    writeString(OBIS_TARIFF_INDICATOR "(");
+    writeNumber(currentTariff(), 4);
+    writeString(")\r\n");
+    if (legacy) {
+        writeLine(OBIS_ACTUAL_DELIVERED, delivered / 10, 4, 2, "kW");
+        writeLine(OBIS_ACTUAL_PRODUCED, produced / 10, 4, 2, "kW");
+    } else {
+        writeLine(OBIS_ACTUAL_DELIVERED, delivered, 2, 3, "kW");
+        writeLine(OBIS_ACTUAL_PRODUCED, produced, 2, 3, "kW");
+
+        writeString(OBIS_NUMBER_POWER_FAIL "(");
+        writeNumber(powerFailures, 5);
+        writeString(")\r\n" OBIS_LONG_POWER_FAIL "(");
+        writeNumber(config.NumberOfPowerFailureLogs, 5);
+        writeString(")\r\n" OBIS_POWER_LOG "(");
+        writeNumber(config.NumberOfPowerFailureLogs, 0);
+        writeString(")(" OBIS_POWER_LOG_ITEM ")");
+        for (uint8_t i = 1; i <= config.NumberOfPowerFailureLogs; i++) {
+            writeString("(");
+            writeDateTime(config.Start - i * 86400UL);
+            writeString(")(");
+            writeNumber(240UL * i, 10);
+            writeString("*s)");
+        }
+        writeString("\r\n");
+
+        static const char *sagCodes[3] = { OBIS_NUM_VOLTAGE_SAG_L1, OBIS_NUM_VOLTAGE_SAG_L2, OBIS_NUM_VOLTAGE_SAG_L3 };
+        static const char *swellCodes[3] = { OBIS_NUM_VOLTAGE_SWL_L1, OBIS_NUM_VOLTAGE_SWL_L2, OBIS_NUM_VOLTAGE_SWL_L3 };
+        for (uint8_t phase = 0; phase < config.NumberOfPhases; phase++) {
+            writeLine(sagCodes[phase], sags[phase], 5, 0, NULL);
+        }
+        for (uint8_t phase = 0; phase < config.NumberOfPhases; phase++) {
+            writeLine(swellCodes[phase], swells[phase], 5, 0, NULL);
+        }
+    }
+
+    writeString(OBIS_TEXT_MESSAGE "(");
+    for (const char *c = textMessage; *c != 0; c++) {
+        char hex[3] = { hexDigits[(uint8_t)*c >> 4], hexDigits[*c & 0x0F], 0 };
+        writeString(hex);
+    }
+    writeString(")\r\n");
+
+    if (!legacy) {
+        static const char *voltageCodes[3] = { OBIS_VOLTAGE_L1, OBIS_VOLTAGE_L2, OBIS_VOLTAGE_L3 };
+        static const char *currentCodes[3] = { OBIS_CURRENT_L1, OBIS_CURRENT_L2, OBIS_CURRENT_L3 };
+        static const char *deliveredCodes[3] = { OBIS_POWER_POS_L1, OBIS_POWER_POS_L2, OBIS_POWER_POS_L3 };
+        static const char *producedCodes[3] = { OBIS_POWER_NEG_L1, OBIS_POWER_NEG_L2, OBIS_POWER_NEG_L3 };
+
+        if (config.Version >= 50) {
+            for (uint8_t phase = 0; phase < config.NumberOfPhases; phase++) {
+                writeLine(voltageCodes[phase], voltage[phase], 3, 1, "V");
+            }
+        }
+        for (uint8_t phase = 0; phase < config.NumberOfPhases; phase++) {
+            uint32_t absolutePower = power[phase] < 0 ? -power[phase] : power[phase];
+            writeLine(currentCodes[phase], (absolutePower * 10 + voltage[phase] / 2) / voltage[phase], 3, 0, "A");
+        }
+        for (uint8_t phase = 0; phase < config.NumberOfPhases; phase++) {
+            writeLine(deliveredCodes[phase], power[phase] > 0 ? power[phase] : 0, 2, 3, "kW");
+        }
+        for (uint8_t phase = 0; phase < config.NumberOfPhases; phase++) {
+            writeLine(producedCodes[phase], power[phase] < 0 ? -power[phase] : 0, 2, 3, "kW");
+        }
+    }
+
+    // M-Bus devices, gas readings every 5 minutes on DSMR 5 and every hour before
+    uint32_t readingInterval = config.Version >= 50 ? 300 : 3600;
+    uint32_t readingTime = seconds - seconds % readingInterval;
+    for (uint8_t device = 1; device <= config.NumberOfMBusDevices; device++) {
+        char prefix[5] = { '0', '-', (char)('0' + device), ':', 0 };
+        writeString(prefix);
+        writeString(legacy ? "24.1.0(03)\r\n" : "24.1.0(003)\r\n");
+        writeString(prefix);
+        writeString("96.1.0(");
+        writeString(gasEquipmentId);
+        writeString(")\r\n");
+        writeString(prefix);
+
+        uint32_t reading = gas + device * 1000000UL + (readingTime > config.Start ? (readingTime - config.Start) / 30 : 0); // 2 dm3 per minute
+        if (legacy) {
+            writeString("24.3.0(");
+            char dateTime[P1_DATETIME_LENGTH];
+            P1SecondsToDateTime(readingTime, dateTime, false);
+            dateTime[12] = 0;
+            writeString(dateTime);
+            writeString(")(08)(60)(1)(0-");
+            writeNumber(device, 1);
+            writeString(":24.2.1)(m3)\r\n(");
+            writeFixed(reading, 5, 3);
+            writeString(")\r\n");
+        } else {
+            writeString("24.2.1(");
+            writeDateTime(readingTime);
+            writeString(")(");
+            writeFixed(reading, 5, 3);
+            writeString("*m3)\r\n");
+        }
+    }
+
+    writeString("!");
+    if (!legacy) {
+        uint16_t crc = CRC16_IBM_REVERSED(output, out - output);
+        char crcText[5] = { hexDigits[crc >> 12], hexDigits[(crc >> 8) & 0x0F], hexDigits[(crc >> 4) & 0x0F], hexDigits[crc & 0x0F], 0 };
+        writeString(crcText);
+    }
+    writeString("\r\n");
+    if (overflow) return 0;
+
+    step();
+    return out - output;
+}
+
+/**
+ * @brief Gets the timestamp of the next telegram
+ *
+ * @return uint32_t Seconds since 2000-01-01
+ */
+uint32_t P1TelegramGenerator::Seconds() {
+    return seconds;
+}
+
+
+/***************** Helper functions *****************/
+
+void P1TelegramGenerator::step() {
+    for (uint8_t phase = 0; phase < config.NumberOfPhases; phase++) {
+        power[phase] += (int32_t)(nextRandom() % 401) - 200;
+        int32_t lowest = (config.Production && phase == 0) ? -3500 : 50;
+        if (power[phase] < lowest) power[phase] = lowest;
+        if (power[phase] > 5000) power[phase] = 5000;
+
+        voltage[phase] += (int32_t)(nextRandom() % 21) - 10;
+        if (voltage[phase] < 2200) voltage[phase] = 2200;
+        if (voltage[phase] > 2450) voltage[phase] = 2450;
+
+        if (nextRandom() % 100000 == 0) sags[phase]++;
+        if (nextRandom() % 100000 == 0) swells[phase]++;
+
+        // Integrate the energy in Ws and move whole Wh to the register of the current tariff
+        uint8_t tariffIndex = currentTariff() - 1;
+        uint8_t index = power[phase] >= 0 ? tariffIndex : 2 + tariffIndex;
+        energyRemainder[index] += (uint32_t)(power[phase] >= 0 ? power[phase] : -power[phase]) * interval;
+        registers[index] += energyRemainder[index] / 3600;
+        energyRemainder[index] %= 3600;
+    }
+
+    seconds += interval;
+}
+
+uint8_t P1TelegramGenerator::currentTariff() {
+    // High tariff (2) on weekdays from 07:00 to 23:00. 2000-01-01 was a saturday
+    uint32_t secondOfDay = seconds % 86400;
+    bool weekday = (seconds / 86400 + 5) % 7 < 5;
+    return (weekday && secondOfDay >= 7 * 3600UL && secondOfDay < 23 * 3600UL) ? 2 : 1;
+}
+
+uint32_t P1TelegramGenerator::nextRandom() {
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+void P1TelegramGenerator::writeString(const char *value) {
+    while (*value != 0 && out < end) {
+        *out++ = *value++;
+    }
+    if (*value != 0) overflow = true;
+}
+
+void P1TelegramGenerator::writeNumber(uint32_t value, uint8_t digits) {
+    // Leading zeros up to the digits, but never fewer digits than the value needs. 0 digits is the natural width
+    uint8_t needed = 1;
+    for (uint32_t rest = value / 10; rest != 0; rest /= 10) needed++;
+    if (digits < needed) digits = needed;
+
+    if (end - out < digits) {
+        overflow = true;
+        return;
+    }
+    for (int8_t i = digits - 1; i >= 0; i--) {
+        out[i] = '0' + value % 10;
+        value /= 10;
+    }
+    out += digits;
+}
+
+void P1TelegramGenerator::writeFixed(uint32_t value, uint8_t integerDigits, uint8_t decimals) {
+    uint32_t divider = 1;
+    for (uint8_t i = 0; i < decimals; i++) divider *= 10;
+
+    writeNumber(value / divider, integerDigits);
+    if (decimals == 0) return;
+    writeString(".");
+    writeNumber(value % divider, decimals);
+}
+
+void P1TelegramGenerator::writeDateTime(uint32_t seconds) {
+    if (end - out < P1_DATETIME_LENGTH) {
+        overflow = true;
+        return;
+    }
+    P1SecondsToDateTime(seconds, out, false);
+    uint8_t monthValue = (out[2] - '0') * 10 + (out[3] - '0');
+    out[12] = (monthValue >= 4 && monthValue <= 10) ? 'S' : 'W'; // Roughly the daylight saving period
+    out += P1_DATETIME_LENGTH;
+}
+
+void P1TelegramGenerator::writeLine(const char *obis, uint32_t value, uint8_t integerDigits, uint8_t decimals, const char *unit) {
+    writeString(obis);
+    writeString("(");
+    writeFixed(value, integerDigits, decimals);
+    if (unit != NULL) {
+        writeString("*");
+        writeString(unit);
+    }
+    writeString(")\r\n");
+}
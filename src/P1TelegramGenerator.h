@@ -0,0 +1,81 @@
+/**
+ * @file P1TelegramGenerator.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Generates realistic, CRC valid P1 telegrams for testing without a meter
+ * @version 0.1
+ * @date 2022-03-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The registers only go up and the power follows a random walk, so the output passes the same checks as a real meter.
+ * See extras/host for a tool writing the telegrams to a file, pipe or pseudo terminal
+ */
+
+#ifndef P1TELEGRAMGENERATOR_H
+#define P1TELEGRAMGENERATOR_H
+
+#include <Arduino.h>
+#include "P1DateTime.h"
+
+#define GENERATOR_MAX_TEXT_MESSAGE 64 // Characters of the text message before hex encoding
+#define GENERATOR_MAX_POWER_LOGS   10 // The power failure event log of DSMR holds up to 10 entries
+
+/**
+ * @brief Layout of the generated telegrams
+ *
+ */
+struct P1GeneratorConfig {
+    uint8_t Version = 50; // DSMR version: 22 or 30 (no CRC, 10 s interval), 40 or 42 (10 s interval), 50 (1 s interval)
+    uint8_t NumberOfPhases = 3; // 1 or 3
+    uint8_t NumberOfMBusDevices = 1; // Gas meters, up to 4
+    uint8_t NumberOfPowerFailureLogs = 0; // Entries in the power failure event log, up to 10 as in DSMR
+    const char *TextMessage = NULL; // Optional text message, sent hex encoded
+    bool Production = false; // Simulate solar panels on L1
+    uint32_t Start = 700000000UL; // Timestamp of the first telegram in seconds since 2000-01-01
+    uint32_t Seed = 1;
+};
+
+/**
+ * @brief Generates a stream of telegrams with evolving values
+ *
+ */
+class P1TelegramGenerator {
+public:
+    P1TelegramGenerator(const P1GeneratorConfig &config);
+
+    uint16_t Next(char *output, uint16_t size);
+    uint32_t Seconds();
+
+private:
+    void step();
+    uint8_t currentTariff();
+    uint32_t nextRandom();
+
+    void writeString(const char *value);
+    void writeNumber(uint32_t value, uint8_t digits);
+    void writeFixed(uint32_t value, uint8_t integerDigits, uint8_t decimals);
+    void writeDateTime(uint32_t seconds);
+    void writeLine(const char *obis, uint32_t value, uint8_t integerDigits, uint8_t decimals, const char *unit);
+
+    P1GeneratorConfig config;
+    char textMessage[GENERATOR_MAX_TEXT_MESSAGE + 1];
+
+    char *out;
+    char *end;
+    bool overflow;
+
+    uint32_t seconds;
+    uint16_t interval;
+    uint32_t randomState;
+
+    uint32_t registers[4] = {}; // Delivered tariff 1 and 2, produced tariff 1 and 2 in Wh
+    uint32_t energyRemainder[4] = {}; // Ws not yet registered
+    int32_t power[3] = {}; // Net power per phase in W
+    uint32_t voltage[3]; // In 100 mV
+    uint32_t sags[3] = {};
+    uint32_t swells[3] = {};
+    uint32_t powerFailures = 0;
+    uint32_t gas = 0; // Reading of the first gas meter at the start in dm3
+};
+
+#endif // P1TELEGRAMGENERATOR_H
@@ -0,0 +1,104 @@
+/**
+ * @file P1Unit.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief Units of the values in the P1 telegram with their power of ten scale
+ * @version 0.1
+ * @date 2022-04-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note The parser uses the scale to normalise values sent in another unit than usual, e.g. W instead of kW,
+ * by parsing them with more or less decimals
+ */
+
+#ifndef P1UNIT_H
+#define P1UNIT_H
+
+#include <Arduino.h>
+
+#define P1_UNIT_NAME_SIZE 4 // Longest name plus the terminator
+
+enum EP1Unit {
+    Unit_None,      // Counters and values without a unit
+    Unit_Wh,
+    Unit_kWh,
+    Unit_W,
+    Unit_kW,
+    Unit_V,
+    Unit_A,
+    Unit_m3,
+    Unit_GJ,
+    Unit_s,
+    Unit_Unknown    // A unit not in this list
+};
+
+/**
+ * @brief Name, power of ten and quantity of a unit. Units of the same quantity convert into each other by their scale
+ *
+ */
+struct P1UnitInfo {
+    char Name[P1_UNIT_NAME_SIZE];
+    int8_t Scale; // Power of ten of the base unit, 3 for kWh
+    uint8_t Quantity;
+};
+
+// Indexed by EP1Unit
+static const P1UnitInfo P1_UNITS[] PROGMEM = {
+    { "", 0, 0 },
+    { "Wh", 0, 1 },
+    { "kWh", 3, 1 },
+    { "W", 0, 2 },
+    { "kW", 3, 2 },
+    { "V", 0, 3 },
+    { "A", 0, 4 },
+    { "m3", 0, 5 },
+    { "GJ", 9, 6 },
+    { "s", 0, 7 },
+    { "", 0, 0xFF }
+};
+
+/**
+ * @brief Parses the unit of a value
+ *
+ * @param unit The first character of the unit, e.g. after the '*' in (01.193*kW)
+ * @return EP1Unit The unit, Unit_Unknown when it is not known
+ */
+inline EP1Unit P1ParseUnit(const char *unit) {
+    uint8_t length = 0;
+    while (length < P1_UNIT_NAME_SIZE && unit[length] != ')' && unit[length] != '(' && unit[length] != '\r' && unit[length] != 0) length++;
+    if (length == 0) return Unit_None;
+    if (length == P1_UNIT_NAME_SIZE) return Unit_Unknown;
+
+    for (uint8_t i = Unit_Wh; i < Unit_Unknown; i++) {
+        if (strncmp_P(unit, P1_UNITS[i].Name, length) == 0 && pgm_read_byte(&P1_UNITS[i].Name[length]) == 0) return (EP1Unit)i;
+    }
+    return Unit_Unknown;
+}
+
+/**
+ * @brief Gets the power of ten of a unit relative to its base unit, e.g. 3 for kWh
+ *
+ */
+inline int8_t P1UnitScale(EP1Unit unit) {
+    return (int8_t)pgm_read_byte(&P1_UNITS[unit].Scale);
+}
+
+/**
+ * @brief Checks whether two units measure the same quantity, e.g. Wh and kWh
+ *
+ */
+inline bool P1SameQuantity(EP1Unit unit, EP1Unit other) {
+    return pgm_read_byte(&P1_UNITS[unit].Quantity) == pgm_read_byte(&P1_UNITS[other].Quantity);
+}
+
+/**
+ * @brief Copies the name of a unit, e.g. for printing
+ *
+ * @param unit The unit
+ * @param name Receives the zero terminated name, at least P1_UNIT_NAME_SIZE characters
+ */
+inline void P1UnitName(EP1Unit unit, char *name) {
+    memcpy_P(name, P1_UNITS[unit].Name, P1_UNIT_NAME_SIZE);
+}
+
+#endif // P1UNIT_H
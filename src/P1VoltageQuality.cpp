@@ -0,0 +1,208 @@
+/**
+ * @file P1VoltageQuality.cpp
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief 10 minute voltage statistics per phase for EN 50160 power quality reports
+ * @version 0.1
+ * @date 2022-06-11
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "P1VoltageQuality.h"
+#include "P1Register.h"
+
+/**
+ * @brief Construct a new voltage quality stage
+ *
+ * @param nominalVoltage The nominal voltage in 100 mV, e.g. 2300 for 230 V
+ * @param callback The function called with every completed window, may be NULL
+ */
+P1VoltageQuality::P1VoltageQuality(uint16_t nominalVoltage, P1VoltageWindowCallback callback) {
+    this->callback = callback;
+    Summary.Nominal = nominalVoltage;
+    Reset();
+}
+
+/**
+ * @brief Adds a telegram. The window before is completed by the first telegram of a new window
+ *
+ * @param data The parsed telegram
+ */
+void P1VoltageQuality::Update(const P1Data &data) {
+    uint32_t seconds = P1DateTimeToSeconds(data.DateTime);
+    if (seconds == 0) return;
+
+    uint32_t start = seconds - seconds % VOLTAGE_WINDOW_SECONDS;
+    if (!started || start != window.Start) { // Also when the clock went back, e.g. at the end of summer time
+        if (started) closeWindow();
+        startWindow(start);
+    }
+
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        uint16_t voltage = data.Voltage[phase] > 0xFFFF ? 0xFFFF : data.Voltage[phase];
+        if (voltage == 0) continue; // Not reported, e.g. a single phase connection
+
+        sumOfSquares[phase] += (uint32_t)voltage * voltage;
+        if (window.Samples[phase] == 0 || voltage < window.Min[phase]) window.Min[phase] = voltage;
+        if (voltage > window.Max[phase]) window.Max[phase] = voltage;
+        if (window.Samples[phase] < 0xFFFF) window.Samples[phase]++;
+    }
+
+    const uint32_t current[6] = { data.VoltageSags[0], data.VoltageSags[1], data.VoltageSags[2],
+                                  data.VoltageSwells[0], data.VoltageSwells[1], data.VoltageSwells[2] };
+    for (uint8_t i = 0; i < 6 && hasCounters; i++) {
+        uint32_t delta = P1RegisterDelta(current[i], counters[i]);
+        if (i < 3) {
+            Summary.Sags[i] += delta;
+        } else {
+            Summary.Swells[i - 3] += delta;
+        }
+    }
+    memcpy(counters, current, sizeof(counters));
+    hasCounters = true;
+}
+
+/**
+ * @brief Completes the current window, e.g. before reporting at the end of the month
+ *
+ */
+void P1VoltageQuality::Flush() {
+    if (started) closeWindow();
+    started = false;
+}
+
+/**
+ * @brief Clears the summary to start the next report. The current window is kept
+ *
+ */
+void P1VoltageQuality::Reset() {
+    uint16_t nominal = Summary.Nominal;
+    memset(&Summary, 0, sizeof(Summary));
+    Summary.Nominal = nominal;
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        Summary.Min[phase] = 0xFFFF;
+    }
+}
+
+/**
+ * @brief Adds a summary to another, e.g. the weeks of a month or the parts of an archive reduced on different cores. Split the
+ * telegrams at the start of a window, a window split in two is counted twice
+ *
+ * @param into The summary to add to
+ * @param from The summary to add
+ * @return bool False when the nominal voltages differ, nothing is added then
+ */
+bool P1VoltageQuality::Merge(P1VoltageSummary &into, const P1VoltageSummary &from) {
+    if (into.Nominal != from.Nominal) return false;
+
+    if (from.Start != 0 && (into.Start == 0 || from.Start < into.Start)) into.Start = from.Start;
+    if (from.End > into.End) into.End = from.End;
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        into.Samples[phase] += from.Samples[phase];
+        if (from.Min[phase] < into.Min[phase]) into.Min[phase] = from.Min[phase];
+        if (from.Max[phase] > into.Max[phase]) into.Max[phase] = from.Max[phase];
+        into.Sags[phase] += from.Sags[phase];
+        into.Swells[phase] += from.Swells[phase];
+
+        for (uint8_t bin = 0; bin < VOLTAGE_BINS; bin++) {
+            uint32_t count = (uint32_t)into.Bins[phase][bin] + from.Bins[phase][bin];
+            into.Bins[phase][bin] = count > 0xFFFF ? 0xFFFF : count;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Judges the 10 minute means of a summary against the EN 50160 limits. Means of exactly a limit are within, the binning
+ * keeps means beyond a limit out of the bin holding it, e.g. 253.1 V is above for 230 V
+ *
+ * @param summary The summary, e.g. of a week or a month
+ * @return P1VoltageCompliance The judgement per phase
+ */
+P1VoltageCompliance P1VoltageQuality::Evaluate(const P1VoltageSummary &summary) {
+    P1VoltageCompliance compliance;
+    memset(&compliance, 0, sizeof(compliance));
+
+    // The bins holding the -15 %, -10 % and +10 % limits
+    int16_t bins[3];
+    for (uint8_t i = 0; i < 3; i++) bins[i] = binOf(limitOf(summary.Nominal, i));
+
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        uint32_t within = 0;
+        for (int16_t bin = 0; bin < VOLTAGE_BINS; bin++) {
+            uint16_t count = summary.Bins[phase][bin];
+            compliance.Windows[phase] += count;
+            if (bin < bins[0]) compliance.Below[phase] += count;
+            if (bin > bins[2]) compliance.Above[phase] += count;
+            if (bin >= bins[1] && bin <= bins[2]) within += count;
+        }
+
+        uint32_t windows = compliance.Windows[phase];
+        compliance.WithinPermille[phase] = windows == 0 ? 1000 : (uint16_t)((uint64_t)within * 1000 / windows);
+        compliance.Compliant[phase] = compliance.WithinPermille[phase] >= 950 && compliance.Below[phase] == 0 && compliance.Above[phase] == 0;
+    }
+    return compliance;
+}
+
+
+/***************** Helper functions *****************/
+
+void P1VoltageQuality::startWindow(uint32_t start) {
+    memset(&window, 0, sizeof(window));
+    memset(sumOfSquares, 0, sizeof(sumOfSquares));
+    window.Start = start;
+    started = true;
+}
+
+void P1VoltageQuality::closeWindow() {
+    for (uint8_t phase = 0; phase < 3; phase++) {
+        if (window.Samples[phase] == 0) continue;
+        window.Mean[phase] = squareRoot(sumOfSquares[phase] / window.Samples[phase]);
+
+        // A mean beyond a limit goes to the neighbouring bin instead of the one holding the limit, so @see Evaluate judges it exactly
+        int32_t mean = window.Mean[phase];
+        int16_t bin = binOf(mean);
+        for (uint8_t i = 0; i < 3; i++) {
+            int32_t limit = limitOf(Summary.Nominal, i);
+            if (bin != binOf(limit)) continue;
+            if (i < 2 && mean < limit && bin > 0) bin--;
+            if (i == 2 && mean > limit && bin < VOLTAGE_BINS - 1) bin++;
+        }
+        if (Summary.Bins[phase][bin] < 0xFFFF) Summary.Bins[phase][bin]++;
+
+        Summary.Samples[phase] += window.Samples[phase];
+        if (window.Min[phase] < Summary.Min[phase]) Summary.Min[phase] = window.Min[phase];
+        if (window.Max[phase] > Summary.Max[phase]) Summary.Max[phase] = window.Max[phase];
+    }
+
+    if (Summary.Start == 0 || window.Start < Summary.Start) Summary.Start = window.Start;
+    if (window.Start + VOLTAGE_WINDOW_SECONDS > Summary.End) Summary.End = window.Start + VOLTAGE_WINDOW_SECONDS;
+
+    if (callback != NULL) callback(window);
+}
+
+int32_t P1VoltageQuality::limitOf(uint16_t nominal, uint8_t limit) {
+    static const uint8_t percentages[3] = { 85, 90, 110 }; // -15 %, -10 % and +10 %
+    return (int32_t)nominal * percentages[limit] / 100;
+}
+
+int16_t P1VoltageQuality::binOf(int32_t voltage) {
+    if (voltage < VOLTAGE_BIN_LOW) return 0;
+    int32_t bin = (voltage - VOLTAGE_BIN_LOW) / VOLTAGE_BIN_WIDTH;
+    return bin >= VOLTAGE_BINS ? VOLTAGE_BINS - 1 : bin;
+}
+
+uint16_t P1VoltageQuality::squareRoot(uint64_t value) {
+    // Bit by bit, the means of the squares of 16 bit voltages fit in 32 bits
+    uint32_t remainder = value > 0xFFFFFFFFUL ? 0xFFFFFFFFUL : value, root = 0;
+    for (uint32_t bit = 1UL << 30; bit != 0; bit >>= 2) {
+        if (remainder >= root + bit) {
+            remainder -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+    }
+    return root;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file P1VoltageQuality.h
+ * @author Ruben Neurink-Sluiman (ruben.neurink@gmail.com)
+ * @brief 10 minute voltage statistics per phase for EN 50160 power quality reports
+ * @version 0.1
+ * @date 2022-06-11
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * @note EN 50160 judges the 10 minute means of the voltage: 95 % of them within 10 % of the nominal voltage and all of them
+ * within -15 % and +10 %. The means are the root of the mean of the squared voltages, aligned to the clock, and counted in
+ * histograms of fixed 0.5 V bins, where a mean beyond a limit never shares the bin of the limit, so a month of telegrams takes no more memory than a day. Summaries of different months or of
+ * parts of the data reduced on several cores are added with @see P1VoltageQuality::Merge. The summary takes about 1 KB of RAM
+ */
+
+#ifndef P1VOLTAGEQUALITY_H
+#define P1VOLTAGEQUALITY_H
+
+#include <Arduino.h>
+#include "P1MeterParser.h"
+
+#ifndef NOMINAL_VOLTAGE
+#define NOMINAL_VOLTAGE 2300 // 230 V in 100 mV, used when the meter doesn't report the voltage
+#endif
+
+#define VOLTAGE_WINDOW_SECONDS  600
+#define VOLTAGE_BIN_LOW         1900 // 190 V in 100 mV, lower means are counted in the first bin
+#define VOLTAGE_BIN_WIDTH       5 // 0.5 V
+#define VOLTAGE_BINS            160 // Up to 270 V, higher means are counted in the last bin
+
+/**
+ * @brief Statistics of a single 10 minute window
+ *
+ */
+struct P1VoltageWindow {
+    uint32_t Start; // Start of the window in seconds since 2000-01-01, see P1DateTimeToSeconds
+    uint16_t Mean[3]; // Root mean square of the voltage per phase in 100 mV, 0 without samples
+    uint16_t Min[3]; // Lowest voltage per phase in 100 mV
+    uint16_t Max[3]; // Highest voltage per phase in 100 mV
+    uint16_t Samples[3]; // Number of telegrams with the voltage of the phase
+};
+
+/**
+ * @brief Mergeable summary of any number of windows
+ *
+ */
+struct P1VoltageSummary {
+    uint16_t Nominal; // Nominal voltage in 100 mV, summaries are only merged with the same nominal voltage
+    uint32_t Start; // Start of the first window, 0 when empty
+    uint32_t End; // End of the last window
+    uint32_t Samples[3]; // Number of telegrams per phase
+    uint16_t Min[3]; // Lowest voltage of all telegrams per phase in 100 mV, 0xFFFF when empty
+    uint16_t Max[3]; // Highest voltage of all telegrams per phase in 100 mV
+    uint32_t Sags[3]; // Increase of the voltage sag counters of the meter
+    uint32_t Swells[3]; // Increase of the voltage swell counters of the meter
+    uint16_t Bins[3][VOLTAGE_BINS]; // 10 minute means per phase, saturating at 0xFFFF (well over a year)
+};
+
+/**
+ * @brief Judgement of a summary against EN 50160
+ *
+ */
+struct P1VoltageCompliance {
+    uint32_t Windows[3]; // Number of 10 minute means per phase
+    uint16_t WithinPermille[3]; // 10 minute means within 10 % of the nominal voltage in permille
+    uint32_t Below[3]; // 10 minute means below -15 %
+    uint32_t Above[3]; // 10 minute means above +10 %
+    bool Compliant[3]; // At least 95 % within 10 % and none below -15 % or above +10 %. True without windows
+};
+
+/**
+ * @brief Called for every completed window
+ *
+ * @param window The window statistics
+ */
+typedef void (*P1VoltageWindowCallback)(const P1VoltageWindow &window);
+
+/**
+ * @brief Summarises the voltage of the telegrams into 10 minute windows. Run it after every @see P1Meter::ProcessTelegram
+ *
+ */
+class P1VoltageQuality {
+public:
+    P1VoltageQuality(uint16_t nominalVoltage = NOMINAL_VOLTAGE, P1VoltageWindowCallback callback = NULL);
+
+    void Update(const P1Data &data);
+    void Flush();
+    void Reset();
+
+    static bool Merge(P1VoltageSummary &into, const P1VoltageSummary &from);
+    static P1VoltageCompliance Evaluate(const P1VoltageSummary &summary);
+
+    P1VoltageSummary Summary; // The completed windows
+
+private:
+    void startWindow(uint32_t start);
+    void closeWindow();
+    static int32_t limitOf(uint16_t nominal, uint8_t limit);
+    static int16_t binOf(int32_t voltage);
+    static uint16_t squareRoot(uint64_t value);
+
+    P1VoltageWindowCallback callback;
+
+    P1VoltageWindow window;
+    uint64_t sumOfSquares[3];
+    uint32_t counters[6]; // Sag counters L1 to L3 and swell counters L1 to L3 of the previous telegram
+    bool started = false;
+    bool hasCounters = false;
+};
+
+#endif // P1VOLTAGEQUALITY_H